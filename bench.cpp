@@ -0,0 +1,414 @@
+#include "bullsat.hpp"
+#include "bench.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+using namespace bullsat;
+
+// Every instance is solved in a child process so that its peak RSS can be
+// measured and a crash doesn't stop the run.
+
+struct Result {
+  std::string instance;
+  // SAT, UNSAT, UNKNOWN, WRONG (a model that fails the check) or ERROR
+  std::string status = "ERROR";
+  double parse_seconds = 0;
+  double solve_seconds = 0;
+  uint64_t conflicts = 0;
+  uint64_t decisions = 0;
+  uint64_t propagations = 0;
+  long peak_rss_kb = 0;
+
+  [[nodiscard]] double per_second(uint64_t count) const {
+    return solve_seconds > 0 ? static_cast<double>(count) / solve_seconds : 0;
+  }
+};
+
+void help() {
+  std::cout << "Usage: bench [options] <cnf-file|directory>..." << std::endl;
+  std::cout << "Options:" << std::endl;
+  std::cout << "  --jobs=<n> (default: 1)" << std::endl;
+  std::cout << "  --time-limit=<seconds> (default: 60)" << std::endl;
+  std::cout << "  --csv=<file>" << std::endl;
+  std::cout << "  --json=<file>" << std::endl;
+  std::cout << "  --baseline=<csv-file> (fail on a regression)" << std::endl;
+  std::cout << "  --tolerance=<percent> (default: 20)" << std::endl;
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+// Solve `path` and write the numbers of Result to `fd`.
+[[noreturn]] void run_child(const std::string &path, double time_limit,
+                            int fd) {
+  const auto start = std::chrono::steady_clock::now();
+  auto input = InputStream::open(path);
+  if (!input) {
+    _exit(1);
+  }
+  SolverOptions options;
+  options.keep_input_clauses = true;
+  Solver solver = Solver(0, options);
+  if (load_dimacs(*input, solver)) {
+    _exit(1);
+  }
+  input.reset();
+  const double parse_seconds = seconds_since(start);
+
+  Budget budget;
+  budget.seconds = time_limit;
+  solver.set_budget(budget);
+  const auto solve_start = std::chrono::steady_clock::now();
+  const Status status = solver.solve();
+  const double solve_seconds = seconds_since(solve_start);
+
+  std::ostringstream os;
+  const bool wrong = status == Status::Sat && !solver.check_model();
+  os << (wrong                     ? "WRONG"
+         : status == Status::Sat   ? "SAT"
+         : status == Status::Unsat ? "UNSAT"
+                                   : "UNKNOWN")
+     << " " << parse_seconds << " " << solve_seconds << " "
+     << solver.stats.conflicts << " " << solver.stats.decisions << " "
+     << solver.stats.propagations << "\n";
+  const std::string line = os.str();
+  // A line is shorter than PIPE_BUF, so it is written at once.
+  if (write(fd, line.data(), line.size()) !=
+      static_cast<ssize_t>(line.size())) {
+    _exit(1);
+  }
+  _exit(0);
+}
+
+std::vector<Result> run(const std::vector<std::string> &instances,
+                        size_t jobs, double time_limit) {
+  std::vector<Result> results(instances.size());
+  // child pid -> (instance, read end of its pipe)
+  std::map<pid_t, std::pair<size_t, int>> running;
+  size_t next = 0;
+  while (next < instances.size() || !running.empty()) {
+    while (next < instances.size() && running.size() < jobs) {
+      results[next].instance = instances[next];
+      int fds[2];
+      if (pipe(fds) != 0) {
+        std::cerr << "c pipe failed" << std::endl;
+        std::exit(1);
+      }
+      const pid_t pid = fork();
+      if (pid < 0) {
+        std::cerr << "c fork failed" << std::endl;
+        std::exit(1);
+      }
+      if (pid == 0) {
+        close(fds[0]);
+        run_child(instances[next], time_limit, fds[1]);
+      }
+      close(fds[1]);
+      running[pid] = {next, fds[0]};
+      next++;
+    }
+
+    int wstatus = 0;
+    struct rusage usage = {};
+    const pid_t pid = wait4(-1, &wstatus, 0, &usage);
+    if (pid < 0) {
+      std::cerr << "c wait failed" << std::endl;
+      std::exit(1);
+    }
+    const auto [index, fd] = running[pid];
+    running.erase(pid);
+    std::string line;
+    char buf[256];
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0) {
+      line.append(buf, static_cast<size_t>(n));
+    }
+    close(fd);
+
+    Result &result = results[index];
+    // ru_maxrss is in kilobytes on Linux.
+    result.peak_rss_kb = usage.ru_maxrss;
+    if (WIFEXITED(wstatus) && WEXITSTATUS(wstatus) == 0) {
+      std::istringstream is(line);
+      is >> result.status >> result.parse_seconds >> result.solve_seconds >>
+          result.conflicts >> result.decisions >> result.propagations;
+    }
+    std::cout << "c " << result.instance << " " << result.status << " "
+              << result.solve_seconds << "s" << std::endl;
+  }
+  return results;
+}
+
+const char *CSV_HEADER = "instance,status,parse_seconds,solve_seconds,"
+                         "conflicts,decisions,propagations,"
+                         "conflicts_per_second,propagations_per_second,"
+                         "peak_rss_kb";
+
+// A CSV field, quoted if it has a separator, a quote or a line break
+std::string csv_field(const std::string &value) {
+  if (value.find_first_of(",\"\r\n") == std::string::npos) {
+    return value;
+  }
+  std::string quoted = "\"";
+  for (const char c : value) {
+    if (c == '"') {
+      quoted += '"';
+    }
+    quoted += c;
+  }
+  return quoted + "\"";
+}
+
+// The fields of the next CSV record. A quoted field can span lines.
+std::optional<std::vector<std::string>> read_record(std::istream &is) {
+  if (is.peek() == EOF) {
+    return std::nullopt;
+  }
+  std::vector<std::string> values(1);
+  bool quoted = false;
+  for (int c = is.get(); c != EOF; c = is.get()) {
+    if (quoted) {
+      if (c != '"') {
+        values.back() += static_cast<char>(c);
+      } else if (is.peek() == '"') {
+        values.back() += static_cast<char>(is.get());
+      } else {
+        quoted = false;
+      }
+    } else if (c == '"') {
+      quoted = true;
+    } else if (c == ',') {
+      values.emplace_back();
+    } else if (c == '\n') {
+      break;
+    } else {
+      values.back() += static_cast<char>(c);
+    }
+  }
+  return values;
+}
+
+// `value` as a JSON string
+std::string json_string(const std::string &value) {
+  const char *hex = "0123456789abcdef";
+  std::string escaped = "\"";
+  for (const char c : value) {
+    const auto u = static_cast<unsigned char>(c);
+    if (c == '"' || c == '\\') {
+      escaped += '\\';
+      escaped += c;
+    } else if (u < 0x20) {
+      escaped += "\\u00";
+      escaped += hex[u >> 4];
+      escaped += hex[u & 15];
+    } else {
+      escaped += c;
+    }
+  }
+  return escaped + "\"";
+}
+
+void write_csv(const std::vector<Result> &results, std::ostream &os) {
+  os << CSV_HEADER << "\n";
+  for (const Result &r : results) {
+    os << csv_field(r.instance) << "," << r.status << ","
+       << r.parse_seconds << "," << r.solve_seconds << "," << r.conflicts
+       << "," << r.decisions << "," << r.propagations << ","
+       << r.per_second(r.conflicts) << "," << r.per_second(r.propagations)
+       << "," << r.peak_rss_kb << "\n";
+  }
+}
+
+void write_json(const std::vector<Result> &results, std::ostream &os) {
+  os << "[\n";
+  for (size_t i = 0; i < results.size(); i++) {
+    const Result &r = results[i];
+    os << "  {\"instance\": " << json_string(r.instance)
+       << ", \"status\": " << json_string(r.status)
+       << ", \"parse_seconds\": " << r.parse_seconds
+       << ", \"solve_seconds\": " << r.solve_seconds
+       << ", \"conflicts\": " << r.conflicts
+       << ", \"decisions\": " << r.decisions
+       << ", \"propagations\": " << r.propagations
+       << ", \"conflicts_per_second\": " << r.per_second(r.conflicts)
+       << ", \"propagations_per_second\": " << r.per_second(r.propagations)
+       << ", \"peak_rss_kb\": " << r.peak_rss_kb << "}"
+       << (i + 1 < results.size() ? "," : "") << "\n";
+  }
+  os << "]\n";
+}
+
+std::optional<std::vector<Result>> read_csv(const std::string &path) {
+  std::ifstream is(path);
+  std::string line;
+  if (!is || !std::getline(is, line) || line != CSV_HEADER) {
+    return std::nullopt;
+  }
+  std::vector<Result> results;
+  while (const std::optional<std::vector<std::string>> record =
+             read_record(is)) {
+    const std::vector<std::string> &values = record.value();
+    if (values.size() != 10) {
+      return std::nullopt;
+    }
+    Result r;
+    r.instance = values[0];
+    r.status = values[1];
+    try {
+      r.parse_seconds = std::stod(values[2]);
+      r.solve_seconds = std::stod(values[3]);
+      r.conflicts = std::stoull(values[4]);
+      r.decisions = std::stoull(values[5]);
+      r.propagations = std::stoull(values[6]);
+      r.peak_rss_kb = std::stol(values[9]);
+    } catch (const std::invalid_argument &) {
+      return std::nullopt;
+    } catch (const std::out_of_range &) {
+      return std::nullopt;
+    }
+    results.push_back(r);
+  }
+  return results;
+}
+
+// Report answers that differ and instances that got slower by more than
+// `tolerance`. Returns the number of regressions.
+size_t compare(const std::vector<Result> &results,
+               const std::vector<Result> &baseline, double tolerance) {
+  // Differences below this are noise.
+  constexpr double MIN_SECONDS = 0.05;
+  std::map<std::string, Result> base;
+  for (const Result &r : baseline) {
+    base[r.instance] = r;
+  }
+  auto solved = [](const Result &r) {
+    return r.status == "SAT" || r.status == "UNSAT";
+  };
+  size_t regressions = 0;
+  for (const Result &r : results) {
+    auto it = base.find(r.instance);
+    if (it == base.end()) {
+      continue;
+    }
+    const Result &b = it->second;
+    std::string problem;
+    if (solved(r) && solved(b) && r.status != b.status) {
+      problem = "answer " + r.status + " (baseline " + b.status + ")";
+    } else if (solved(b) && !solved(r)) {
+      problem = r.status + " (baseline " + b.status + ")";
+    } else if (solved(r) && r.solve_seconds - b.solve_seconds > MIN_SECONDS &&
+               r.solve_seconds > b.solve_seconds * (1.0 + tolerance)) {
+      problem = "slower " + std::to_string(r.solve_seconds) + "s (baseline " +
+                std::to_string(b.solve_seconds) + "s)";
+    }
+    if (!problem.empty()) {
+      std::cout << "c regression: " << r.instance << ": " << problem
+                << std::endl;
+      regressions++;
+    }
+  }
+  return regressions;
+}
+
+int main(int argc, char *argv[]) {
+  size_t jobs = 1;
+  double time_limit = 60;
+  double tolerance = 0.2;
+  std::optional<std::string> csv, json, baseline;
+  std::vector<std::string> paths;
+  for (int i = 1; i < argc; i++) {
+    const std::string arg = argv[i];
+    const std::string jobs_opt = "--jobs=";
+    const std::string time_limit_opt = "--time-limit=";
+    const std::string csv_opt = "--csv=";
+    const std::string json_opt = "--json=";
+    const std::string baseline_opt = "--baseline=";
+    const std::string tolerance_opt = "--tolerance=";
+    if (arg.rfind(jobs_opt, 0) == 0) {
+      auto n = parse_count(arg.substr(jobs_opt.size()));
+      if (!n || n.value() == 0) {
+        help();
+        std::exit(1);
+      }
+      jobs = n.value();
+    } else if (arg.rfind(time_limit_opt, 0) == 0) {
+      auto seconds = parse_count(arg.substr(time_limit_opt.size()));
+      if (!seconds) {
+        help();
+        std::exit(1);
+      }
+      time_limit = static_cast<double>(seconds.value());
+    } else if (arg.rfind(csv_opt, 0) == 0) {
+      csv = arg.substr(csv_opt.size());
+    } else if (arg.rfind(json_opt, 0) == 0) {
+      json = arg.substr(json_opt.size());
+    } else if (arg.rfind(baseline_opt, 0) == 0) {
+      baseline = arg.substr(baseline_opt.size());
+    } else if (arg.rfind(tolerance_opt, 0) == 0) {
+      auto percent = parse_count(arg.substr(tolerance_opt.size()));
+      if (!percent) {
+        help();
+        std::exit(1);
+      }
+      tolerance = static_cast<double>(percent.value()) / 100.0;
+    } else if (arg.rfind("--", 0) == 0) {
+      help();
+      std::exit(1);
+    } else {
+      paths.push_back(arg);
+    }
+  }
+  const std::vector<std::string> instances = collect_instances(paths);
+  if (instances.empty()) {
+    help();
+    std::exit(1);
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  const std::vector<Result> results = run(instances, jobs, time_limit);
+  size_t sat = 0, unsat = 0, unknown = 0;
+  double solve_seconds = 0;
+  for (const Result &r : results) {
+    sat += r.status == "SAT";
+    unsat += r.status == "UNSAT";
+    unknown += r.status != "SAT" && r.status != "UNSAT";
+    solve_seconds += r.solve_seconds;
+  }
+  std::cout << "c SAT: " << sat << " UNSAT: " << unsat
+            << " UNKNOWN: " << unknown << std::endl;
+  std::cout << "c solve seconds: " << solve_seconds
+            << " wall seconds: " << seconds_since(start) << std::endl;
+
+  if (csv) {
+    std::ofstream os(csv.value());
+    write_csv(results, os);
+  }
+  if (json) {
+    std::ofstream os(json.value());
+    write_json(results, os);
+  }
+  if (baseline) {
+    auto base = read_csv(baseline.value());
+    if (!base) {
+      std::cerr << "c cannot read " << baseline.value() << std::endl;
+      std::exit(1);
+    }
+    if (compare(results, base.value(), tolerance) > 0) {
+      std::exit(1);
+    }
+  }
+}
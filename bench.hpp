@@ -0,0 +1,49 @@
+#ifndef BULLSAT_BENCH_HPP_
+#define BULLSAT_BENCH_HPP_
+#include <algorithm>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Helpers of the benchmark tools, bench.cpp and micro.cpp.
+
+inline std::optional<size_t> parse_count(const std::string &value) {
+  if (value.empty() || value.size() > 18 ||
+      value.find_first_not_of("0123456789") != std::string::npos) {
+    return std::nullopt;
+  }
+  return std::stoull(value);
+}
+
+// CNF files under `paths` in a fixed order
+inline std::vector<std::string> collect_instances(
+    const std::vector<std::string> &paths) {
+  auto is_cnf = [](const std::string &name) {
+    for (const std::string suffix : {".cnf", ".cnf.gz", ".cnf.xz"}) {
+      if (name.size() >= suffix.size() &&
+          name.compare(name.size() - suffix.size(), suffix.size(), suffix) ==
+              0) {
+        return true;
+      }
+    }
+    return false;
+  };
+  std::vector<std::string> instances;
+  for (const std::string &path : paths) {
+    if (!std::filesystem::is_directory(path)) {
+      instances.push_back(path);
+      continue;
+    }
+    for (const auto &entry :
+         std::filesystem::recursive_directory_iterator(path)) {
+      if (entry.is_regular_file() && is_cnf(entry.path().string())) {
+        instances.push_back(entry.path().string());
+      }
+    }
+  }
+  std::sort(instances.begin(), instances.end());
+  return instances;
+}
+
+#endif // BULLSAT_BENCH_HPP_
@@ -1,29 +1,57 @@
 #ifndef BULLSAT_HPP_
 #define BULLSAT_HPP_
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cerrno>
+#include <charconv>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
 #include <deque>
+#include <fcntl.h>
+#include <functional>
 #include <iostream>
+#include <iterator>
+#include <limits>
 #include <memory>
-#include <numeric>
+#include <mutex>
 #include <optional>
-#include <regex>
-#include <set>
-#include <sstream>
-#include <unordered_set>
+#include <random>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <tuple>
+#include <unistd.h>
 #include <utility>
 #include <vector>
+#ifdef BULLSAT_ZLIB
+#include <zlib.h>
+#endif
+#ifdef BULLSAT_LZMA
+#include <lzma.h>
+#endif
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
 
 namespace bullsat {
 
 // definitions
 enum class Status { Sat, Unsat, Unknown };
-enum class LitBool { True, False, Undefine };
+enum class LitBool : int8_t { True, False, Undefine };
 using Var = int;
 struct Lit;
 using Clause = std::vector<Lit>;
-using CRef = std::shared_ptr<Clause>;
-using CWRef = std::weak_ptr<Clause>;
+// offset of a clause in ClauseArena
+using CRef = uint32_t;
+constexpr CRef CREF_UNDEF = std::numeric_limits<CRef>::max();
 
 // x is
 // even: positive x0 (0 -> x0, 2 -> x1)
@@ -56,12 +84,464 @@ inline Lit operator~(Lit p) {
   return q;
 }
 
-struct Heap {
+// Values of literals are bytes indexed by Lit::lidx(). An array of them is
+// followed by VALUE_PADDING readable bytes, so that a 4-byte gather at the
+// last literal stays inside it.
+constexpr size_t VALUE_PADDING = 3;
+
+// The position of the first of lits[0..n) whose value is (if `Equal`) or
+// isn't `value`, or n if there is none. With AVX2, 8 values are gathered
+// at a time. Other targets (NEON has no gather) take the scalar loop.
+template <bool Equal>
+inline size_t find_value(const Lit *lits, size_t n, const LitBool *values,
+                         LitBool value) {
+  size_t i = 0;
+#ifdef __AVX2__
+  // The literals are loaded as packed 32-bit indices.
+  static_assert(sizeof(Lit) == sizeof(int32_t));
+  const __m256i low_byte = _mm256_set1_epi32(0xff);
+  const __m256i wanted = _mm256_set1_epi32(static_cast<int>(value));
+  for (; i + 8 <= n; i += 8) {
+    const __m256i idx =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(lits + i));
+    const __m256i gathered = _mm256_i32gather_epi32(
+        reinterpret_cast<const int *>(values), idx, 1);
+    const __m256i equal =
+        _mm256_cmpeq_epi32(_mm256_and_si256(gathered, low_byte), wanted);
+    const int mask = _mm256_movemask_ps(_mm256_castsi256_ps(equal));
+    const int hits = Equal ? mask : ~mask & 0xff;
+    if (hits != 0) {
+      const auto lowest = __builtin_ctz(static_cast<unsigned>(hits));
+      return i + static_cast<size_t>(lowest);
+    }
+  }
+#endif
+  for (; i < n; i++) {
+    if ((values[lits[i].lidx()] == value) == Equal) {
+      return i;
+    }
+  }
+  return n;
+}
+
+// Padded literal values of `model`. Both literals of a variable beyond the
+// model are false.
+inline std::vector<LitBool> model_values(const std::vector<bool> &model,
+                                         size_t var_num) {
+  std::vector<LitBool> values(2 * var_num + VALUE_PADDING, LitBool::False);
+  for (size_t v = 0; v < std::min(model.size(), var_num); v++) {
+    values[2 * v + (model[v] ? 0 : 1)] = LitBool::True;
+  }
+  return values;
+}
+
+enum class RestartPolicy { None, Geometric, Luby, Glucose };
+enum class BranchingHeuristic { Evsids, Vmtf, Switch };
+
+struct SolverOptions {
+  RestartPolicy restart = RestartPolicy::Glucose;
+  // Geometric: restart_first * restart_inc^n conflicts
+  // Luby: restart_first * luby(n) conflicts
+  double restart_first = 100;
+  double restart_inc = 1.5;
+  // Glucose: restart if the recent LBD average exceeds the long-term one by
+  // 1/restart_margin, but block a restart if the trail is restart_block
+  // times longer than usual.
+  double restart_margin = 0.8;
+  double restart_block = 1.4;
+  // Learnt clauses whose LBD <= core_lbd are kept forever and those whose
+  // LBD <= tier2_lbd are kept while they are used.
+  uint32_t core_lbd = 2;
+  uint32_t tier2_lbd = 6;
+  double clause_decay = 0.999;
+  // Remove literals implied by the other literals of a learnt clause.
+  bool minimize = true;
+  // Remove literals with binary clauses (learnt[0] v ~lit) if the LBD of a
+  // learnt clause is at most binary_minimize_lbd.
+  bool binary_minimize = true;
+  uint32_t binary_minimize_lbd = 6;
+  BranchingHeuristic branching = BranchingHeuristic::Evsids;
+  double var_decay = 0.95;
+  // Switch: the first mode lasts mode_switch_first conflicts and every next
+  // one lasts mode_switch_inc times longer.
+  uint64_t mode_switch_first = 1000;
+  double mode_switch_inc = 1.5;
+  // a polarity of a decision before any assignment is saved
+  bool initial_phase = false;
+  // Decide the target phase (the longest conflict-free assignment since the
+  // last rephase) in stable mode. It pays off with less frequent restarts
+  // (e.g. Luby with BranchingHeuristic::Switch).
+  bool target_phase = false;
+  // Reset saved phases every rephase_interval * n conflicts.
+  bool rephase = true;
+  uint64_t rephase_interval = 1000;
+  uint64_t seed = 0;
+  // Simplify the formula before search.
+  bool preprocess = true;
+  // Failed literal probing stops after probe_limit propagations.
+  uint64_t probe_limit = 2000000;
+  // Subsumption and variable elimination stop after visiting
+  // preprocess_limit literals.
+  uint64_t preprocess_limit = 100000000;
+  // A variable is eliminated if it adds at most elim_grow clauses and no
+  // resolvent is longer than elim_clause_limit.
+  size_t elim_grow = 0;
+  size_t elim_clause_limit = 20;
+  // Vivify and subsume learnt clauses at a restart after
+  // inprocess_interval * n conflicts since the last round, spending
+  // inprocess_effort of the propagations made by search meanwhile.
+  bool inprocess = true;
+  uint64_t inprocess_interval = 2000;
+  double inprocess_effort = 0.1;
+  // ProbSAT local search on the irredundant clauses before search, and at a
+  // restart after walk_interval * n conflicts since the last round. The
+  // first round makes walk_flips flips and a later one walk_effort of the
+  // propagations of search meanwhile. The best assignment of a round
+  // becomes the saved phases.
+  bool walk = true;
+  uint64_t walk_interval = 5000;
+  uint64_t walk_flips = 100000;
+  double walk_effort = 0.05;
+  // Learnt clauses whose LBD <= share_lbd are exported to ClauseExchange.
+  uint32_t share_lbd = 2;
+  // Keep a copy of the input clauses for check_model().
+  bool keep_input_clauses = false;
+  // Backtrack only by one level, keeping the assignments of the lower
+  // levels on the trail, if a backjump would undo more than chrono_levels.
+  bool chrono = false;
+  uint32_t chrono_levels = 100;
+};
+
+// The parts of a solver fixed at compile time, for BasicSolver<Config>. A
+// configuration is a struct with the members of DefaultConfig. A policy
+// fixed here overrides SolverOptions, and the code of a disabled feature
+// is left out of the search loop.
+struct DefaultConfig {
+  // std::nullopt: SolverOptions::restart and SolverOptions::branching
+  static constexpr std::optional<RestartPolicy> restart = std::nullopt;
+  static constexpr std::optional<BranchingHeuristic> branching = std::nullopt;
+  // Local learnt clauses are halved when they outnumber learnt_limit times
+  // the input clauses, and the limit grows by learnt_growth every time.
+  static constexpr bool reduce = true;
+  static constexpr double learnt_limit = 0.3;
+  static constexpr double learnt_growth = 1.1;
+  // DRAT output by write_proof()
+  static constexpr bool proof = true;
+  // the time counters of Stats
+#ifdef BULLSAT_PROFILE
+  static constexpr bool profile = true;
+#else
+  static constexpr bool profile = false;
+#endif
+};
+
+// DefaultConfig with the restart policy and the branching heuristic fixed
+// and without proofs.
+template <RestartPolicy Restart, BranchingHeuristic Heuristic>
+struct SearchConfig : DefaultConfig {
+  static constexpr std::optional<RestartPolicy> restart = Restart;
+  static constexpr std::optional<BranchingHeuristic> branching = Heuristic;
+  static constexpr bool proof = false;
+};
+
+struct Stats {
+  uint64_t conflicts = 0;
+  uint64_t decisions = 0;
+  uint64_t propagations = 0;
+  uint64_t restarts = 0;
+  uint64_t rephases = 0;
+  uint64_t chrono_backtracks = 0;
+  uint64_t learnts_added = 0;
+  uint64_t learnts_deleted = 0;
+  // the sum of the LBDs of conflict clauses
+  uint64_t lbd_sum = 0;
+  uint64_t reductions = 0;
+  uint64_t simplifications = 0;
+  // preprocessing
+  uint64_t failed_literals = 0;
+  uint64_t subsumed = 0;
+  uint64_t strengthened = 0;
+  uint64_t eliminated = 0;
+  // inprocessing
+  uint64_t inprocessings = 0;
+  uint64_t vivified = 0;
+  uint64_t duplicate_binaries = 0;
+  // local search
+  uint64_t walks = 0;
+  uint64_t walk_flips = 0;
+  // clause sharing
+  uint64_t exported = 0;
+  uint64_t imported = 0;
+  // bytes held by the solver when solve() returned or memory was last
+  // checked, see Solver::memory_usage()
+  uint64_t memory_bytes = 0;
+  // reductions forced by Budget::memory_bytes
+  uint64_t memory_reductions = 0;
+  // time in seconds, measured only if Config::profile
+  double propagate_seconds = 0;
+  double analyze_seconds = 0;
+  double reduce_seconds = 0;
+
+  [[nodiscard]] double average_lbd() const {
+    return conflicts == 0 ? 0
+                          : static_cast<double>(lbd_sum) /
+                                static_cast<double>(conflicts);
+  }
+};
+
+// Add the lifetime of a scope to `total` seconds if `Enabled`.
+template <bool Enabled> class ScopedTimer {
+public:
+  explicit ScopedTimer(double &) {}
+};
+template <> class ScopedTimer<true> {
+public:
+  explicit ScopedTimer(double &total)
+      : seconds(total), start(std::chrono::steady_clock::now()) {}
+  ScopedTimer(const ScopedTimer &) = delete;
+  ScopedTimer &operator=(const ScopedTimer &) = delete;
+  ~ScopedTimer() {
+    seconds += std::chrono::duration<double>(
+                   std::chrono::steady_clock::now() - start)
+                   .count();
+  }
+
+private:
+  double &seconds;
+  std::chrono::steady_clock::time_point start;
+};
+
+// Resource limits of solve(). See Solver::set_budget().
+struct Budget {
+  std::optional<uint64_t> conflicts;
+  std::optional<uint64_t> propagations;
+  std::optional<uint64_t> decisions;
+  // wall-clock time
+  std::optional<double> seconds;
+  // Learnt clauses are reduced harder near this many bytes, and solve()
+  // gives up if the solver still needs more.
+  std::optional<uint64_t> memory_bytes;
+};
+
+// Heap memory held by vectors.
+template <typename T> size_t vector_bytes(const std::vector<T> &v) {
+  return v.capacity() * sizeof(T);
+}
+inline size_t vector_bytes(const std::vector<bool> &v) {
+  return v.capacity() / 8;
+}
+template <typename T>
+size_t vector_bytes(const std::vector<std::vector<T>> &vs) {
+  size_t bytes = vs.capacity() * sizeof(std::vector<T>);
+  for (const std::vector<T> &v : vs) {
+    bytes += vector_bytes(v);
+  }
+  return bytes;
+}
+
+// A word of ClauseArena.
+// Header words are accessed through `raw` or `act`, literal words through
+// `lit`.
+union ClauseWord {
+  uint32_t raw;
+  float act;
+  Lit lit;
+};
+
+// Learnt clauses are managed in three tiers by their LBD.
+// Core: kept forever
+// Tier2: kept while they are used in conflicts
+// Local: evicted by their activity
+enum class Tier : uint32_t { Core, Tier2, Local };
+
+// A view of a clause that lives in ClauseArena.
+// Layout: [size][flags|lbd][activity][lit0][lit1]...
+class ArenaClause {
+public:
+  static constexpr size_t HEADER_WORDS = 3;
+  explicit ArenaClause(ClauseWord *p) : ptr(p) {}
+
+  size_t size() const { return ptr[0].raw; }
+  bool learnt() const { return ptr[1].raw & LEARNT; }
+  bool deleted() const { return ptr[1].raw & DELETED; }
+  bool reloced() const { return ptr[1].raw & RELOCED; }
+  // used in a conflict since the last reduction
+  bool used() const { return ptr[1].raw & USED; }
+  bool vivified() const { return ptr[1].raw & VIVIFIED; }
+  Tier tier() const {
+    return static_cast<Tier>((ptr[1].raw & TIER_MASK) >> TIER_SHIFT);
+  }
+  uint32_t lbd() const { return ptr[1].raw >> FLAG_BITS; }
+  float activity() const { return ptr[2].act; }
+  // a new location after compaction
+  CRef relocation() const {
+    assert(reloced());
+    return ptr[2].raw;
+  }
+
+  void set_lbd(uint32_t lbd) {
+    ptr[1].raw = (lbd << FLAG_BITS) | (ptr[1].raw & FLAG_MASK);
+  }
+  void set_activity(float act) { ptr[2].act = act; }
+  void set_used(bool used) {
+    ptr[1].raw = used ? (ptr[1].raw | USED) : (ptr[1].raw & ~USED);
+  }
+  void set_tier(Tier tier) {
+    ptr[1].raw = (ptr[1].raw & ~TIER_MASK) |
+                 (static_cast<uint32_t>(tier) << TIER_SHIFT);
+  }
+  void mark_deleted() { ptr[1].raw |= DELETED; }
+  void mark_vivified() { ptr[1].raw |= VIVIFIED; }
+  void relocate(CRef to) {
+    ptr[1].raw |= RELOCED;
+    ptr[2].raw = to;
+  }
+
+  Lit &operator[](size_t i) { return ptr[HEADER_WORDS + i].lit; }
+  Lit *begin() { return &ptr[HEADER_WORDS].lit; }
+  Lit *end() { return begin() + size(); }
+
+private:
+  friend class ClauseArena;
+  static constexpr uint32_t LEARNT = 1;
+  static constexpr uint32_t DELETED = 2;
+  static constexpr uint32_t RELOCED = 4;
+  static constexpr uint32_t USED = 8;
+  static constexpr uint32_t TIER_SHIFT = 4;
+  static constexpr uint32_t TIER_MASK = 3 << TIER_SHIFT;
+  static constexpr uint32_t VIVIFIED = 64;
+  static constexpr uint32_t FLAG_BITS = 7;
+  static constexpr uint32_t FLAG_MASK = (1 << FLAG_BITS) - 1;
+  ClauseWord *ptr;
+};
+
+// All clauses are stored in one contiguous region and are addressed by
+// offsets(CRef). Freed clauses stay in place until the arena is compacted.
+class ClauseArena {
+public:
+  ClauseArena() = default;
+
+  CRef alloc(const Clause &lits, bool learnt) {
+    const size_t offset = memory.size();
+    assert(offset + ArenaClause::HEADER_WORDS + lits.size() < CREF_UNDEF);
+    memory.resize(offset + ArenaClause::HEADER_WORDS + lits.size());
+    ClauseWord *p = &memory[offset];
+    p[0].raw = static_cast<uint32_t>(lits.size());
+    p[1].raw = learnt ? ArenaClause::LEARNT : 0;
+    p[2].act = 0.0f;
+    for (size_t i = 0; i < lits.size(); i++) {
+      p[ArenaClause::HEADER_WORDS + i].lit = lits[i];
+    }
+    return static_cast<CRef>(offset);
+  }
+  void free(CRef cr) {
+    ArenaClause clause = (*this)[cr];
+    assert(!clause.deleted());
+    clause.mark_deleted();
+    wasted_words += ArenaClause::HEADER_WORDS + clause.size();
+  }
+  // Drop the literals after the first `size` ones.
+  void shrink(CRef cr, size_t size) {
+    ArenaClause clause = (*this)[cr];
+    assert(size <= clause.size());
+    wasted_words += clause.size() - size;
+    clause.ptr[0].raw = static_cast<uint32_t>(size);
+  }
+  // Move a clause to `to` and update `cr` to the new location.
+  // An old clause remembers where it went so that every reference to it can
+  // be updated.
+  void reloc(CRef &cr, ClauseArena &to) {
+    ArenaClause clause = (*this)[cr];
+    if (clause.reloced()) {
+      cr = clause.relocation();
+      return;
+    }
+    const size_t words = ArenaClause::HEADER_WORDS + clause.size();
+    const CRef new_cr = static_cast<CRef>(to.memory.size());
+    const auto first = memory.begin() + static_cast<std::ptrdiff_t>(cr);
+    to.memory.insert(to.memory.end(), first,
+                     first + static_cast<std::ptrdiff_t>(words));
+    clause.relocate(new_cr);
+    cr = new_cr;
+  }
+  ArenaClause operator[](CRef cr) {
+    assert(cr < memory.size());
+    return ArenaClause(&memory[cr]);
+  }
+  // words
+  size_t size() const { return memory.size(); }
+  size_t wasted() const { return wasted_words; }
+  void reserve(size_t words) { memory.reserve(words); }
+  size_t memory_bytes() const { return vector_bytes(memory); }
+  // Copy `words` words of clauses in the arena layout to the end. Returns
+  // where they start.
+  CRef append(const char *data, size_t words) {
+    const size_t offset = memory.size();
+    assert(offset + words < CREF_UNDEF);
+    memory.resize(offset + words);
+    std::memcpy(&memory[offset], data, words * sizeof(ClauseWord));
+    return static_cast<CRef>(offset);
+  }
+  // Drop every clause but keep the memory.
+  void clear() {
+    memory.clear();
+    wasted_words = 0;
+  }
+
+private:
+  std::vector<ClauseWord> memory;
+  size_t wasted_words = 0;
+};
+
+// A snapshot of the irredundant clauses (Solver::write_snapshot()) is
+// SNAPSHOT_MAGIC, SnapshotHeader and then sections of native 32-bit words:
+// the top-level units, the offsets of the clauses in the arena words, the
+// arena words ([size][flags|lbd][activity][lit0]...), the eliminated
+// variables, and the sizes and the literals of the clauses removed by
+// elimination (see extend_model()).
+constexpr char SNAPSHOT_MAGIC[8] = {'B', 'U', 'L', 'L', 'S', 'N', 'A', 'P'};
+constexpr uint32_t SNAPSHOT_VERSION = 1;
+struct SnapshotHeader {
+  static constexpr uint32_t PREPROCESSED = 1;
+  static constexpr uint32_t UNSAT = 2;
+  uint32_t version;
+  uint32_t flags;
+  uint32_t var_num;
+  // section sizes in words
+  uint32_t units;
+  uint32_t clauses;
+  uint32_t arena_words;
+  uint32_t elim_vars;
+  uint32_t elim_clauses;
+  uint32_t elim_lits;
+};
+inline bool is_snapshot(const char *data, size_t size) {
+  return size >= sizeof(SNAPSHOT_MAGIC) &&
+         std::memcmp(data, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) == 0;
+}
+
+// A max-heap of variables by activity with `Arity` children per node. A
+// wider node makes the heap shallower, and the children of a node share a
+// cache line.
+template <size_t Arity> struct DaryHeap {
+  static_assert(Arity >= 2);
+  static constexpr uint32_t NOT_IN_HEAP = std::numeric_limits<uint32_t>::max();
   std::vector<Var> heap;
-  std::vector<std::optional<size_t>> indices;
+  // the position of a variable in `heap`
+  std::vector<uint32_t> indices;
   std::vector<double> activity;
-  Heap() = default;
+  DaryHeap() = default;
 
+  [[nodiscard]] size_t memory_bytes() const {
+    return vector_bytes(heap) + vector_bytes(indices) + vector_bytes(activity);
+  }
+  // Make room for variables [0, var_num).
+  void grow(size_t var_num) {
+    if (var_num > indices.size()) {
+      indices.resize(var_num, NOT_IN_HEAP);
+      activity.resize(var_num, 0.0);
+    }
+  }
   std::optional<Var> top() {
     if (heap.empty()) {
       return {};
@@ -74,49 +554,46 @@ struct Heap {
     return activity[l] > activity[r];
   }
   void heap_up(size_t i) {
-    if (i == 0) {
-      return;
-    }
     Var x = heap[i];
-    size_t p = (i - 1) >> 1;
-
     while (i != 0) {
+      const size_t p = (i - 1) / Arity;
       if (!gt(x, heap[p])) {
         break;
       }
       heap[i] = heap[p];
-      indices[static_cast<size_t>(heap[p])] = i;
+      indices[static_cast<size_t>(heap[i])] = static_cast<uint32_t>(i);
       i = p;
-      p = (p - 1) >> 1;
     }
     heap[i] = x;
-    indices[static_cast<size_t>(x)] = i;
+    indices[static_cast<size_t>(x)] = static_cast<uint32_t>(i);
   }
   void heap_down(size_t i) {
     Var x = heap[i];
-    while (2 * i + 1 < heap.size()) {
-      size_t left = 2 * i + 1;
-      size_t right = 2 * i + 2;
-      size_t child =
-          right < heap.size() && gt(heap[right], heap[left]) ? right : left;
-      if (gt(heap[child], x)) {
-        heap[i] = heap[child];
-        indices[static_cast<size_t>(heap[i])] = i;
-        i = child;
-      } else {
+    while (Arity * i + 1 < heap.size()) {
+      const size_t first = Arity * i + 1;
+      const size_t last = std::min(first + Arity, heap.size());
+      size_t child = first;
+      for (size_t c = first + 1; c < last; c++) {
+        if (gt(heap[c], heap[child])) {
+          child = c;
+        }
+      }
+      if (!gt(heap[child], x)) {
         break;
       }
+      heap[i] = heap[child];
+      indices[static_cast<size_t>(heap[i])] = static_cast<uint32_t>(i);
+      i = child;
     }
     heap[i] = x;
-    indices[static_cast<size_t>(x)] = i;
+    indices[static_cast<size_t>(x)] = static_cast<uint32_t>(i);
   }
   std::optional<Var> pop() {
-
     if (heap.empty()) {
       return {};
     }
     Var x = heap[0];
-    indices[static_cast<size_t>(x)] = std::nullopt;
+    indices[static_cast<size_t>(x)] = NOT_IN_HEAP;
     if (heap.size() > 1) {
       heap[0] = heap.back();
       indices[static_cast<size_t>(heap[0])] = 0;
@@ -134,39 +611,309 @@ struct Heap {
     if (in_heap(v)) {
       return;
     }
-    while (static_cast<size_t>(v) >= indices.size()) {
-      indices.push_back(std::nullopt);
-      activity.push_back(0.0);
-    }
-    assert(!in_heap(v));
-    indices[static_cast<size_t>(v)] = heap.size();
+    grow(static_cast<size_t>(v) + 1);
+    assert(heap.size() < NOT_IN_HEAP);
+    indices[static_cast<size_t>(v)] = static_cast<uint32_t>(heap.size());
     heap.push_back(v);
-    heap_up(indices[static_cast<size_t>(v)].value());
+    heap_up(heap.size() - 1);
+  }
+  // Replace the contents with `vars` in linear time.
+  void build(const std::vector<Var> &vars) {
+    for (const Var v : heap) {
+      indices[static_cast<size_t>(v)] = NOT_IN_HEAP;
+    }
+    heap.clear();
+    for (const Var v : vars) {
+      grow(static_cast<size_t>(v) + 1);
+      assert(!in_heap(v));
+      indices[static_cast<size_t>(v)] = static_cast<uint32_t>(heap.size());
+      heap.push_back(v);
+    }
+    for (size_t i = heap.size() / Arity + 1; i-- > 0;) {
+      if (i < heap.size()) {
+        heap_down(i);
+      }
+    }
   }
   size_t size() const { return heap.size(); }
   bool empty() const { return heap.empty(); }
   bool in_heap(Var x) {
     return static_cast<size_t>(x) < indices.size() &&
-           indices[static_cast<size_t>(x)].has_value();
+           indices[static_cast<size_t>(x)] != NOT_IN_HEAP;
   }
   void increase(Var n) {
     assert(in_heap(n));
-    heap_up(indices[static_cast<size_t>(n)].value());
+    heap_up(indices[static_cast<size_t>(n)]);
   }
   void decrease(Var n) {
     assert(in_heap(n));
-    heap_down(indices[static_cast<size_t>(n)].value());
+    heap_down(indices[static_cast<size_t>(n)]);
   }
   void update(Var n) {
     if (!in_heap(n)) {
       push(n);
     } else {
       const size_t idx = static_cast<size_t>(n);
-      heap_up(indices[idx].value());
-      heap_down(indices[idx].value());
+      heap_up(indices[idx]);
+      heap_down(indices[idx]);
+    }
+  }
+};
+using Heap = DaryHeap<4>;
+// EVSIDS: bump variables in conflicts by an exponentially increasing amount.
+struct Evsids {
+  Evsids() = default;
+  explicit Evsids(double decay) : var_decay(decay) {}
+
+  void new_var(Var v) { heap.push(v); }
+  void reserve(size_t var_num) { heap.grow(var_num); }
+  [[nodiscard]] size_t memory_bytes() const {
+    return heap.memory_bytes() + vector_bytes(rebuild_vars);
+  }
+  void bump(Var v) {
+    const size_t idx = static_cast<size_t>(v);
+    heap.activity[idx] += var_inc;
+    if (heap.activity[idx] > 1e100) {
+      // rescale
+      for (double &act : heap.activity) {
+        act *= 1e-100;
+      }
+      var_inc *= 1e-100;
+    }
+    if (heap.in_heap(v)) {
+      heap.increase(v);
+    }
+  }
+  void decay() { var_inc *= (1.0 / var_decay); }
+  void on_unassign(Var v) {
+    if (!heap.in_heap(v)) {
+      heap.push(v);
+    }
+  }
+  // Start over with the unassigned variables, which is cheaper than
+  // pushing back many of them.
+  template <typename Assigned> void rebuild(size_t var_num, Assigned assigned) {
+    rebuild_vars.clear();
+    for (size_t v = 0; v < var_num; v++) {
+      if (!assigned(Var(v))) {
+        rebuild_vars.push_back(Var(v));
+      }
+    }
+    heap.build(rebuild_vars);
+  }
+  // the most active unassigned variable
+  template <typename Assigned>
+  [[nodiscard]] std::optional<Var> pick(Assigned assigned) {
+    while (std::optional<Var> v = heap.pop()) {
+      if (!assigned(v.value())) {
+        return v;
+      }
+    }
+    return std::nullopt;
+  }
+
+  Heap heap;
+  double var_inc = 1.0;
+  double var_decay = 0.95;
+  std::vector<Var> rebuild_vars;
+};
+
+// VMTF(variable move to front): bumped variables are moved to the end of a
+// doubly linked queue and the most recently bumped unassigned variable is
+// decided.
+// Every variable after `search` in the queue is assigned.
+struct Vmtf {
+  static constexpr Var NONE = -1;
+  struct Link {
+    Var prev = NONE;
+    Var next = NONE;
+  };
+
+  void new_var(Var v) {
+    assert(static_cast<size_t>(v) == links.size());
+    links.emplace_back();
+    stamps.push_back(++stamp);
+    append(v);
+    search = v;
+  }
+  // `v` has to be assigned. (It is in a conflict.)
+  void bump(Var v) {
+    const size_t idx = static_cast<size_t>(v);
+    if (v != last) {
+      unlink(v);
+      append(v);
+    }
+    stamps[idx] = ++stamp;
+  }
+  // Bump variables keeping their relative order in the queue.
+  void bump_all(std::vector<Var> &vars) {
+    std::sort(vars.begin(), vars.end(), [&](Var left, Var right) {
+      return stamps[static_cast<size_t>(left)] <
+             stamps[static_cast<size_t>(right)];
+    });
+    for (const Var v : vars) {
+      bump(v);
+    }
+  }
+  void on_unassign(Var v) {
+    if (search == NONE || stamps[static_cast<size_t>(v)] >
+                              stamps[static_cast<size_t>(search)]) {
+      search = v;
+    }
+  }
+  // The search pointer has no unassigned variables after it.
+  void reset_search() { search = last; }
+  [[nodiscard]] size_t memory_bytes() const {
+    return vector_bytes(links) + vector_bytes(stamps);
+  }
+  template <typename Assigned>
+  [[nodiscard]] std::optional<Var> pick(Assigned assigned) {
+    while (search != NONE && assigned(search)) {
+      search = links[static_cast<size_t>(search)].prev;
+    }
+    if (search == NONE) {
+      return std::nullopt;
+    }
+    return search;
+  }
+
+  std::vector<Link> links;
+  // bumped time
+  std::vector<uint64_t> stamps;
+  Var first = NONE, last = NONE, search = NONE;
+  uint64_t stamp = 0;
+
+private:
+  void unlink(Var v) {
+    Link &link = links[static_cast<size_t>(v)];
+    if (link.prev != NONE) {
+      links[static_cast<size_t>(link.prev)].next = link.next;
+    } else {
+      first = link.next;
+    }
+    if (link.next != NONE) {
+      links[static_cast<size_t>(link.next)].prev = link.prev;
+    } else {
+      last = link.prev;
+    }
+    link = Link();
+  }
+  void append(Var v) {
+    Link &link = links[static_cast<size_t>(v)];
+    link.prev = last;
+    link.next = NONE;
+    if (last != NONE) {
+      links[static_cast<size_t>(last)].next = v;
+    } else {
+      first = v;
+    }
+    last = v;
+  }
+};
+
+// Chooses a decision variable by EVSIDS (stable mode) or VMTF (focused mode).
+// With BranchingHeuristic::Switch, a solver alternates between the modes.
+// A heuristic excluded by Config::branching is never updated.
+template <typename Config> class BasicBranching {
+public:
+  BasicBranching() : BasicBranching(SolverOptions()) {}
+  explicit BasicBranching(const SolverOptions &options)
+      : evsids(options.var_decay),
+        chosen(Config::branching.value_or(options.branching)),
+        stable(chosen != BranchingHeuristic::Vmtf),
+        mode_length(options.mode_switch_first),
+        mode_limit(options.mode_switch_first),
+        mode_inc(options.mode_switch_inc) {
+    if (chosen == BranchingHeuristic::Switch) {
+      // Start focused.
+      stable = false;
+    }
+  }
+
+  void new_var(Var v) {
+    if constexpr (USES_EVSIDS) {
+      evsids.new_var(v);
+    }
+    if constexpr (USES_VMTF) {
+      vmtf.new_var(v);
+    }
+  }
+  void reserve(size_t var_num) { evsids.reserve(var_num); }
+  // Bump variables that took part in a conflict.
+  void bump_all(std::vector<Var> &vars) {
+    if (is_stable()) {
+      for (const Var v : vars) {
+        evsids.bump(v);
+      }
+    } else {
+      vmtf.bump_all(vars);
+    }
+  }
+  void on_conflict(uint64_t conflicts) {
+    if (is_stable()) {
+      evsids.decay();
+    }
+    if (heuristic() == BranchingHeuristic::Switch &&
+        conflicts >= mode_limit) {
+      stable = !stable;
+      vmtf.reset_search();
+      mode_length = static_cast<uint64_t>(static_cast<double>(mode_length) *
+                                          mode_inc);
+      mode_limit = conflicts + mode_length;
+    }
+  }
+  // Every unassigned variable has to be reachable by pick() in both modes.
+  void on_unassign(Var v) {
+    if constexpr (USES_EVSIDS) {
+      evsids.on_unassign(v);
+    }
+    if constexpr (USES_VMTF) {
+      vmtf.on_unassign(v);
+    }
+  }
+  // Instead of on_unassign() for each of many unassigned variables.
+  template <typename Assigned> void rebuild(size_t var_num, Assigned assigned) {
+    if constexpr (USES_EVSIDS) {
+      evsids.rebuild(var_num, assigned);
+    }
+    if constexpr (USES_VMTF) {
+      vmtf.reset_search();
+    }
+  }
+  template <typename Assigned>
+  [[nodiscard]] std::optional<Var> pick(Assigned assigned) {
+    return is_stable() ? evsids.pick(assigned) : vmtf.pick(assigned);
+  }
+  [[nodiscard]] bool is_stable() const {
+    if constexpr (!USES_VMTF) {
+      return true;
+    } else if constexpr (!USES_EVSIDS) {
+      return false;
+    } else {
+      return stable;
     }
   }
+  [[nodiscard]] BranchingHeuristic heuristic() const {
+    return Config::branching.value_or(chosen);
+  }
+  [[nodiscard]] size_t memory_bytes() const {
+    return evsids.memory_bytes() + vmtf.memory_bytes();
+  }
+
+private:
+  static constexpr bool USES_EVSIDS =
+      Config::branching != BranchingHeuristic::Vmtf;
+  static constexpr bool USES_VMTF =
+      Config::branching != BranchingHeuristic::Evsids;
+  Evsids evsids;
+  Vmtf vmtf;
+  BranchingHeuristic chosen;
+  bool stable;
+  uint64_t mode_length, mode_limit;
+  double mode_inc;
 };
+using Branching = BasicBranching<DefaultConfig>;
+
 std::ostream &operator<<(std::ostream &os, const Lit &lit) {
   os << (lit.neg() ? "!x" : "x") << lit.var();
   return os;
@@ -178,184 +925,1225 @@ std::ostream &operator<<(std::ostream &os, const Clause &clause) {
   return os;
 }
 
-class Solver {
-public:
-  Solver() = default;
-  explicit Solver(size_t variable_num)
-      : skip_simplify(false), que_head(0), var_bump_inc(1.0) {
-    assings.resize(variable_num);
-    watchers.resize(2 * variable_num);
-    reasons.resize(variable_num);
-    levels.resize(variable_num);
-    seen.resize(variable_num);
-    que.clear();
-    for (size_t v = 0; v < variable_num; v++) {
-      order_heap.push(Var(v));
-    }
+// Exponential moving average.
+// Early values are averaged with a larger weight so that the average is not
+// biased towards the initial 0.
+struct Ema {
+  Ema() = default;
+  explicit Ema(double a) : alpha(a) {}
+  void update(double x) {
+    count++;
+    const double a = std::max(alpha, 1.0 / static_cast<double>(count));
+    value += a * (x - value);
+  }
+  double value = 0.0;
+  double alpha = 1.0;
+  uint64_t count = 0;
+};
+
+// 1, 1, 2, 1, 1, 2, 4, 1, 1, 2, 1, 1, 2, 4, 8, ...
+inline double luby(double y, uint64_t x) {
+  uint64_t size = 1;
+  int seq = 0;
+  while (size < x + 1) {
+    seq++;
+    size = 2 * size + 1;
+  }
+  while (size - 1 != x) {
+    size = (size - 1) >> 1;
+    seq--;
+    x = x % size;
   }
-  [[nodiscard]] LitBool eval(Lit lit) const {
-    if (!levels[lit.vidx()].has_value()) {
-      return LitBool::Undefine;
+  return std::pow(y, seq);
+}
+
+// Decides when a solver restarts.
+// A solver tells every conflict by on_conflict() and asks should_restart()
+// before the next decision. Config::restart fixes the policy.
+template <typename Config> class BasicRestartScheduler {
+public:
+  BasicRestartScheduler() : BasicRestartScheduler(SolverOptions()) {}
+  explicit BasicRestartScheduler(const SolverOptions &options)
+      : chosen(options.restart), first(options.restart_first),
+        inc(options.restart_inc), margin(options.restart_margin),
+        block(options.restart_block), limit(options.restart_first),
+        fast_lbd(1.0 / 32), slow_lbd(1.0 / 4096), trail_size(1.0 / 4096) {}
+
+  void on_conflict(uint32_t lbd, size_t trail) {
+    conflicts++;
+    if (policy() != RestartPolicy::Glucose) {
+      return;
     }
-    if (lit.neg()) {
-      return assings[lit.vidx()] ? LitBool::False : LitBool::True;
+    fast_lbd.update(lbd);
+    slow_lbd.update(lbd);
+    // Blocking: we may be close to a model, so keep going.
+    if (trail_size.count > BLOCK_WARMUP && conflicts >= MIN_CONFLICTS &&
+        static_cast<double>(trail) > block * trail_size.value) {
+      conflicts = 0;
     }
-    return assings[lit.vidx()] ? LitBool::True : LitBool::False;
+    trail_size.update(static_cast<double>(trail));
   }
-  [[nodiscard]] int decision_level() const {
-    if (que.empty()) {
-      return 0;
+  [[nodiscard]] bool should_restart() const {
+    switch (policy()) {
+    case RestartPolicy::None:
+      return false;
+    case RestartPolicy::Geometric:
+    case RestartPolicy::Luby:
+      return static_cast<double>(conflicts) >= limit;
+    case RestartPolicy::Glucose:
+      return conflicts >= MIN_CONFLICTS &&
+             fast_lbd.value * margin > slow_lbd.value;
     }
-
-    Lit l = que.back();
-    return levels[l.vidx()].value_or(0);
+    return false;
   }
-  void new_decision(Lit lit, std::optional<CRef> reason = std::nullopt) {
-    enqueue(lit, reason);
-    levels[lit.vidx()].value()++;
+  void on_restart() {
+    conflicts = 0;
+    restarts++;
+    if (policy() == RestartPolicy::Geometric) {
+      limit *= inc;
+    } else if (policy() == RestartPolicy::Luby) {
+      limit = first * luby(2, restarts);
+    }
   }
 
-  void enqueue(Lit lit, std::optional<CRef> reason = std::nullopt) {
-    assert(!levels[lit.vidx()].has_value());
-    levels[lit.vidx()] = decision_level();
-    assings[lit.vidx()] = lit.pos() ? true : false;
-    reasons[lit.vidx()] = reason;
-    que.push_back(lit);
+private:
+  static constexpr uint64_t MIN_CONFLICTS = 50;
+  static constexpr uint64_t BLOCK_WARMUP = 10000;
+  [[nodiscard]] RestartPolicy policy() const {
+    return Config::restart.value_or(chosen);
   }
+  RestartPolicy chosen;
+  double first, inc, margin, block;
+  // conflicts since the last restart
+  uint64_t conflicts = 0;
+  uint64_t restarts = 0;
+  double limit;
+  Ema fast_lbd, slow_lbd, trail_size;
+};
+using RestartScheduler = BasicRestartScheduler<DefaultConfig>;
 
-  void pop_queue_until(int until_level) {
-    assert(!que.empty());
+enum class Rephase { Original, Inverted, Best, Random };
 
-    while (!que.empty()) {
-      Lit lit = que.back();
-      if (levels[lit.vidx()] > until_level) {
-        if (!order_heap.in_heap(lit.var())) {
-          order_heap.push(lit.var());
-        }
-        reasons[lit.vidx()] = std::nullopt;
-        levels[lit.vidx()] = std::nullopt;
-        que.pop_back();
-      } else {
-        break;
-      }
+// Decision polarities.
+// saved: the last assigned value (phase saving)
+// target: the longest conflict-free assignment since the last rephase
+// best: the longest conflict-free assignment since the last best rephase
+class Phases {
+public:
+  Phases() : Phases(SolverOptions()) {}
+  explicit Phases(const SolverOptions &options)
+      : initial(options.initial_phase), use_target(options.target_phase),
+        rephase_enabled(options.rephase),
+        rephase_interval(options.rephase_interval),
+        rephase_limit(options.rephase_interval),
+        rng(static_cast<std::mt19937_64::result_type>(options.seed)) {}
+
+  void new_var() {
+    saved.push_back(initial);
+    target.push_back(LitBool::Undefine);
+    best.push_back(LitBool::Undefine);
+  }
+  void save(Lit lit) { saved[lit.vidx()] = lit.pos(); }
+  [[nodiscard]] const std::vector<bool> &saved_phases() const { return saved; }
+  // Replace the saved phases, e.g. with an assignment of local search.
+  void import_saved(const std::vector<bool> &phases) {
+    assert(phases.size() == saved.size());
+    saved = phases;
+  }
+  // The first `consistent` literals of the trail are fully propagated
+  // without a conflict.
+  void update(const std::vector<Lit> &trail, size_t consistent) {
+    if (consistent > target_size) {
+      copy(trail, consistent, target);
+      target_size = consistent;
     }
-    if (que.size() > 0) {
-      que_head = que.size() - 1;
-    } else {
-      que_head = 0;
+    if (consistent > best_size) {
+      copy(trail, consistent, best);
+      best_size = consistent;
     }
   }
-  void var_bump_activity(Var v, double inc) {
+  [[nodiscard]] Lit decide(Var v, bool stable) const {
     const size_t idx = static_cast<size_t>(v);
-    order_heap.activity[idx] += inc;
-    if (order_heap.activity[idx] > 1e100) {
-      // rescale
-      for (size_t i = 0; i < assings.size(); i++) {
-        order_heap.activity[i] *= 1e-100;
-      }
-      var_bump_inc *= 1e-100;
-    }
-    if (order_heap.in_heap(v)) {
-      order_heap.update(v);
+    if (stable && use_target && target[idx] != LitBool::Undefine) {
+      return Lit(v, target[idx] == LitBool::True);
     }
+    return Lit(v, saved[idx]);
   }
-  void new_var() {
-    // literal index
-    Var v = Var(assings.size());
-    watchers.push_back(std::vector<CWRef>());
-    watchers.push_back(std::vector<CWRef>());
-    // variable index
-    assings.push_back(false);
-    seen.push_back(false);
-    reasons.push_back(std::nullopt);
-    levels.push_back(std::nullopt);
-    order_heap.push(v);
+  [[nodiscard]] bool should_rephase(uint64_t conflicts) const {
+    return rephase_enabled && conflicts >= rephase_limit;
   }
-  void unwatch_clause(const CRef &cr) {
-    const Clause &clause = *cr;
-    assert(clause.size() > 1);
-    for (const auto idx : {0, 1}) {
-      std::vector<CWRef> &watcher =
-          watchers[(~clause[static_cast<size_t>(idx)]).lidx()];
-
-      for (size_t i = 0; i < watcher.size(); i++) {
-        assert(!watcher[i].expired());
-        if (watcher[i].lock() == cr) {
-          watcher[i] = watcher.back();
-          watcher.pop_back();
-          break;
+  // Original, Best, Inverted, Best, Random, Best, ...
+  Rephase rephase(uint64_t conflicts) {
+    static constexpr Rephase schedule[] = {Rephase::Original, Rephase::Best,
+                                           Rephase::Inverted, Rephase::Best,
+                                           Rephase::Random,   Rephase::Best};
+    const Rephase kind = schedule[rephases % std::size(schedule)];
+    rephases++;
+    rephase_limit = conflicts + rephase_interval * rephases;
+    switch (kind) {
+    case Rephase::Original:
+      std::fill(saved.begin(), saved.end(), initial);
+      break;
+    case Rephase::Inverted:
+      std::fill(saved.begin(), saved.end(), !initial);
+      break;
+    case Rephase::Best:
+      for (size_t i = 0; i < saved.size(); i++) {
+        if (best[i] != LitBool::Undefine) {
+          saved[i] = best[i] == LitBool::True;
         }
       }
+      std::fill(best.begin(), best.end(), LitBool::Undefine);
+      best_size = 0;
+      break;
+    case Rephase::Random:
+      for (size_t i = 0; i < saved.size(); i++) {
+        saved[i] = rng() & 1;
+      }
+      break;
     }
-    return;
-  }
-  void watch_clause(const CRef &cr) {
-    const Clause &clause = *cr;
-    assert(clause.size() > 1);
-    watchers[(~clause[0]).lidx()].push_back(cr);
-    watchers[(~clause[1]).lidx()].push_back(cr);
+    std::fill(target.begin(), target.end(), LitBool::Undefine);
+    target_size = 0;
+    return kind;
   }
-  void attach_clause(const CRef &cr, bool learnt = false) {
 
-    assert((*cr).size() > 1);
-    watch_clause(cr);
-    if (learnt) {
-      learnts.push_back(cr);
-    } else {
-      clauses.push_back(cr);
+private:
+  static void copy(const std::vector<Lit> &trail, size_t size,
+                   std::vector<LitBool> &phases) {
+    for (size_t i = 0; i < size; i++) {
+      phases[trail[i].vidx()] = trail[i].pos() ? LitBool::True : LitBool::False;
     }
   }
+  bool initial, use_target, rephase_enabled;
+  std::vector<bool> saved;
+  std::vector<LitBool> target, best;
+  size_t target_size = 0, best_size = 0;
+  uint64_t rephases = 0;
+  uint64_t rephase_interval, rephase_limit;
+  std::mt19937_64 rng;
+};
 
-  void add_clause(const Clause &clause) {
-    assert(decision_level() == 0);
-    // grow the size
-    std::for_each(clause.begin(), clause.end(), [&](Lit lit) {
-      if (lit.vidx() >= assings.size()) {
-        new_var();
-      }
-    });
-    Clause ps = clause;
-    size_t new_len = 0;
-    std::sort(ps.begin(), ps.end());
-    for (size_t i = 0; i < ps.size(); i++) {
-      if (eval(ps[i]) == LitBool::True) {
-        return;
-      }
-      if (i >= 1) {
-        if (ps[i] == ~ps[i - 1]) {
-          return;
-        }
-        if (ps[i] == ps[i - 1]) {
-          continue;
+// ProbSAT local search. Every step picks a falsified clause and flips one
+// of its variables with a probability that falls with the break count of
+// the variable, the number of clauses satisfied only by it. Clauses and
+// occurrence lists are flat arrays, and break counts are updated by flips.
+class LocalSearch {
+public:
+  explicit LocalSearch(uint64_t seed = 0)
+      : rng(static_cast<std::mt19937_64::result_type>(seed)) {}
+
+  // Drop the clauses, starting over with variables [0, var_num).
+  void reset(size_t var_num) {
+    lits.clear();
+    clause_start.assign(1, 0);
+    values.assign(var_num, 0);
+  }
+  template <typename Iterator> void add_clause(Iterator begin, Iterator end) {
+    lits.insert(lits.end(), begin, end);
+    assert(lits.size() < std::numeric_limits<uint32_t>::max());
+    clause_start.push_back(static_cast<uint32_t>(lits.size()));
+  }
+  [[nodiscard]] size_t num_clauses() const { return clause_start.size() - 1; }
+  // Flip at most max_flips times from `initial`, a value for each variable.
+  // Returns true if every clause is satisfied by best().
+  bool run(const std::vector<bool> &initial, uint64_t max_flips) {
+    assert(initial.size() == values.size());
+    build_occurrences();
+    build_probabilities();
+    const size_t n = num_clauses();
+    for (size_t v = 0; v < values.size(); v++) {
+      values[v] = initial[v] ? 1 : 0;
+    }
+    true_counts.assign(n, 0);
+    critical.assign(n, 0);
+    break_counts.assign(values.size(), 0);
+    unsat.clear();
+    unsat_pos.assign(n, 0);
+    for (uint32_t c = 0; c < n; c++) {
+      for (uint32_t i = clause_start[c]; i < clause_start[c + 1]; i++) {
+        if (is_true(lits[i])) {
+          true_counts[c]++;
+          critical[c] ^= static_cast<uint32_t>(lits[i].vidx());
         }
       }
-      if (eval(ps[i]) != LitBool::False) {
-        ps[new_len++] = ps[i];
+      if (true_counts[c] == 0) {
+        add_unsat(c);
+      } else if (true_counts[c] == 1) {
+        break_counts[critical[c]]++;
       }
     }
-    ps.resize(new_len);
-    if (ps.empty()) {
-      status = Status::Unsat;
-    } else if (ps.size() == 1) {
-      // Unit Clause
-      enqueue(ps[0]);
-    } else {
-      CRef cr = std::make_shared<Clause>(ps);
-      attach_clause(cr);
+    best_values = initial;
+    best_unsat = unsat.size();
+    changed.clear();
+    changed_mark.assign(values.size(), false);
+    flips = 0;
+    while (!unsat.empty() && flips < max_flips) {
+      const uint32_t c = unsat[rng() % unsat.size()];
+      const uint32_t v = pick(c);
+      flip(v);
+      flips++;
+      if (!changed_mark[v]) {
+        changed_mark[v] = true;
+        changed.push_back(v);
+      }
+      if (unsat.size() < best_unsat) {
+        best_unsat = unsat.size();
+        save_best();
+      }
     }
+    return best_unsat == 0;
   }
-  [[nodiscard]] std::optional<CRef> propagate() {
-    while (que_head < que.size()) {
-      assert(que_head >= 0);
-      const Lit lit = que[que_head++];
+  // the assignment with the fewest falsified clauses in the last run
+  [[nodiscard]] const std::vector<bool> &best() const { return best_values; }
+  void reseed(uint64_t seed) {
+    rng.seed(static_cast<std::mt19937_64::result_type>(seed));
+  }
+  // Free the clauses and the state of the last run.
+  void release() {
+    LocalSearch empty;
+    empty.rng = rng;
+    *this = std::move(empty);
+  }
+  [[nodiscard]] size_t memory_bytes() const {
+    return vector_bytes(lits) + vector_bytes(clause_start) +
+           vector_bytes(occ_start) + vector_bytes(occs) +
+           vector_bytes(values) + vector_bytes(true_counts) +
+           vector_bytes(critical) + vector_bytes(break_counts) +
+           vector_bytes(unsat) + vector_bytes(unsat_pos) +
+           vector_bytes(best_values) + vector_bytes(changed) +
+           vector_bytes(changed_mark) + vector_bytes(scores);
+  }
+  // flips of the last run
+  uint64_t flips = 0;
+
+private:
+  static constexpr size_t MAX_BREAK = 64;
+  [[nodiscard]] bool is_true(Lit lit) const {
+    return (values[lit.vidx()] != 0) == lit.pos();
+  }
+  void build_occurrences() {
+    occ_start.assign(2 * values.size() + 1, 0);
+    for (const Lit lit : lits) {
+      occ_start[lit.lidx() + 1]++;
+    }
+    for (size_t i = 1; i < occ_start.size(); i++) {
+      occ_start[i] += occ_start[i - 1];
+    }
+    occs.resize(lits.size());
+    std::vector<uint32_t> fill(occ_start.begin(), occ_start.end() - 1);
+    for (uint32_t c = 0; c < num_clauses(); c++) {
+      for (uint32_t i = clause_start[c]; i < clause_start[c + 1]; i++) {
+        occs[fill[lits[i].lidx()]++] = c;
+      }
+    }
+  }
+  // The polynomial break function for 3-SAT and the exponential one for
+  // longer clauses, with the constants of the ProbSAT paper.
+  void build_probabilities() {
+    const size_t n = std::max<size_t>(num_clauses(), 1);
+    const size_t average = (lits.size() + n / 2) / n;
+    const double cb = average <= 3   ? 2.38
+                      : average == 4 ? 3.0
+                      : average == 5 ? 3.7
+                      : average == 6 ? 5.1
+                                     : 5.4;
+    for (size_t b = 0; b < MAX_BREAK; b++) {
+      const double d = static_cast<double>(b);
+      probabilities[b] = average <= 3 ? std::pow(1.0 + d, -cb)
+                                      : std::pow(cb, -d);
+    }
+  }
+  [[nodiscard]] uint32_t pick(uint32_t c) {
+    const uint32_t begin = clause_start[c];
+    const uint32_t end = clause_start[c + 1];
+    scores.resize(end - begin);
+    double sum = 0;
+    for (uint32_t i = begin; i < end; i++) {
+      const uint32_t b = break_counts[lits[i].vidx()];
+      sum += probabilities[std::min<size_t>(b, MAX_BREAK - 1)];
+      scores[i - begin] = sum;
+    }
+    // uniform in [0, sum)
+    const double r = static_cast<double>(rng() >> 11) * 0x1.0p-53 * sum;
+    uint32_t i = begin;
+    while (i + 1 < end && scores[i - begin] <= r) {
+      i++;
+    }
+    return static_cast<uint32_t>(lits[i].vidx());
+  }
+  void flip(uint32_t v) {
+    values[v] ^= 1;
+    const Lit now_true = Lit(Var(v), values[v] != 0);
+    const Lit now_false = ~now_true;
+    for (uint32_t i = occ_start[now_true.lidx()];
+         i < occ_start[now_true.lidx() + 1]; i++) {
+      const uint32_t c = occs[i];
+      const uint32_t before = true_counts[c]++;
+      if (before == 0) {
+        remove_unsat(c);
+        break_counts[v]++;
+      } else if (before == 1) {
+        break_counts[critical[c]]--;
+      }
+      critical[c] ^= v;
+    }
+    for (uint32_t i = occ_start[now_false.lidx()];
+         i < occ_start[now_false.lidx() + 1]; i++) {
+      const uint32_t c = occs[i];
+      const uint32_t after = --true_counts[c];
+      critical[c] ^= v;
+      if (after == 0) {
+        add_unsat(c);
+        break_counts[v]--;
+      } else if (after == 1) {
+        break_counts[critical[c]]++;
+      }
+    }
+  }
+  void add_unsat(uint32_t c) {
+    unsat_pos[c] = static_cast<uint32_t>(unsat.size());
+    unsat.push_back(c);
+  }
+  void remove_unsat(uint32_t c) {
+    const uint32_t last = unsat.back();
+    unsat[unsat_pos[c]] = last;
+    unsat_pos[last] = unsat_pos[c];
+    unsat.pop_back();
+  }
+  // Copy the variables flipped since the last best assignment.
+  void save_best() {
+    for (const uint32_t v : changed) {
+      best_values[v] = values[v] != 0;
+      changed_mark[v] = false;
+    }
+    changed.clear();
+  }
+
+  // the literals of clause c are lits[clause_start[c]..clause_start[c + 1]]
+  std::vector<Lit> lits;
+  std::vector<uint32_t> clause_start;
+  // the clauses of literal l are occs[occ_start[l]..occ_start[l + 1]]
+  std::vector<uint32_t> occ_start, occs;
+  std::vector<uint8_t> values;
+  // true literals of a clause and the XOR of their variables, which is the
+  // variable itself if there is only one
+  std::vector<uint32_t> true_counts, critical;
+  std::vector<uint32_t> break_counts;
+  // falsified clauses and their positions in `unsat`
+  std::vector<uint32_t> unsat, unsat_pos;
+  std::vector<bool> best_values;
+  size_t best_unsat = 0;
+  // variables flipped since the last best assignment
+  std::vector<uint32_t> changed;
+  std::vector<bool> changed_mark;
+  double probabilities[MAX_BREAK] = {};
+  std::vector<double> scores;
+  std::mt19937_64 rng;
+};
+
+// Text and binary output collected in memory, with integers formatted in
+// place instead of through temporary strings.
+class OutputBuffer {
+public:
+  void reserve(size_t capacity) { data.reserve(capacity); }
+  void append(char c) { data.push_back(c); }
+  void append(const char *text) { data += text; }
+  void append_int(int64_t n) {
+    char digits[24];
+    const auto result = std::to_chars(digits, digits + sizeof(digits), n);
+    data.append(digits, result.ptr);
+  }
+  // a literal in DIMACS
+  void append_lit(Lit lit) {
+    const int64_t v = static_cast<int64_t>(lit.vidx()) + 1;
+    append_int(lit.neg() ? -v : v);
+  }
+  [[nodiscard]] size_t size() const { return data.size(); }
+  [[nodiscard]] bool empty() const { return data.empty(); }
+  // Exchange the contents, keeping the capacity of both.
+  void swap(std::string &other) { data.swap(other); }
+  void write_to(std::ostream &os) {
+    os.write(data.data(), static_cast<std::streamsize>(data.size()));
+    data.clear();
+  }
+
+private:
+  std::string data;
+};
+
+// A DRAT proof in the text or the binary format. Clauses are encoded into
+// a buffer, and a full buffer is written by a background thread so that
+// the solver rarely waits for the output.
+class ProofWriter {
+public:
+  ProofWriter(std::ostream &output, bool binary_format)
+      : os(output), binary(binary_format), writer([this]() { run(); }) {
+    buffer.reserve(BUFFER_SIZE + BUFFER_SLACK);
+  }
+  ProofWriter(const ProofWriter &) = delete;
+  ProofWriter &operator=(const ProofWriter &) = delete;
+  ~ProofWriter() {
+    flush();
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopped = true;
+    }
+    cv.notify_all();
+    writer.join();
+  }
+
+  template <typename Iterator> void add(Iterator begin, Iterator end) {
+    write_clause(false, begin, end);
+  }
+  template <typename Iterator> void remove(Iterator begin, Iterator end) {
+    write_clause(true, begin, end);
+  }
+  // Wait until everything is written.
+  void flush() {
+    hand_over();
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [&]() { return pending.empty() && !writing; });
+    os.flush();
+  }
+
+private:
+  static constexpr size_t BUFFER_SIZE = 1 << 20;
+  // room for the clause that fills the buffer
+  static constexpr size_t BUFFER_SLACK = 1 << 12;
+
+  template <typename Iterator>
+  void write_clause(bool deletion, Iterator begin, Iterator end) {
+    if (binary) {
+      buffer.append(deletion ? 'd' : 'a');
+      for (Iterator it = begin; it != end; ++it) {
+        // 2 * DIMACS variable + sign in 7-bit groups
+        uint64_t u = 2 * (static_cast<uint64_t>(it->vidx()) + 1) +
+                     (it->neg() ? 1 : 0);
+        while (u > 127) {
+          buffer.append(static_cast<char>((u & 127) | 128));
+          u >>= 7;
+        }
+        buffer.append(static_cast<char>(u));
+      }
+      buffer.append('\0');
+    } else {
+      if (deletion) {
+        buffer.append("d ");
+      }
+      for (Iterator it = begin; it != end; ++it) {
+        buffer.append_lit(*it);
+        buffer.append(' ');
+      }
+      buffer.append("0\n");
+    }
+    if (buffer.size() >= BUFFER_SIZE) {
+      hand_over();
+    }
+  }
+  // Pass the buffer to the writer, waiting for the previous one.
+  void hand_over() {
+    if (buffer.empty()) {
+      return;
+    }
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      cv.wait(lock, [&]() { return pending.empty(); });
+      buffer.swap(pending);
+    }
+    cv.notify_all();
+  }
+  void run() {
+    std::string chunk;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+      cv.wait(lock, [&]() { return stopped || !pending.empty(); });
+      if (pending.empty()) {
+        return;
+      }
+      std::swap(chunk, pending);
+      writing = true;
+      lock.unlock();
+      cv.notify_all();
+      os.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+      chunk.clear();
+      lock.lock();
+      writing = false;
+      cv.notify_all();
+    }
+  }
+
+  std::ostream &os;
+  bool binary;
+  OutputBuffer buffer;
+  // guarded by `mutex`
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::string pending;
+  bool writing = false;
+  bool stopped = false;
+  // started last, after the members it uses
+  std::thread writer;
+};
+
+// Learnt clauses shared by portfolio workers.
+// Each worker appends to its own ring buffer without locks and the others
+// read it with their own cursors. A slot is guarded by a sequence number
+// (a seqlock), so a reader that falls behind by more than the capacity
+// skips overwritten clauses instead of blocking the writer.
+class ClauseExchange {
+public:
+  // longest clause to share
+  static constexpr size_t MAX_SIZE = 16;
+  static constexpr size_t CAPACITY = 1 << 12;
+
+  explicit ClauseExchange(size_t workers) {
+    for (size_t i = 0; i < workers; i++) {
+      rings.push_back(std::make_unique<Ring>());
+    }
+  }
+  [[nodiscard]] size_t num_workers() const { return rings.size(); }
+  void publish(size_t worker, const Clause &clause, uint32_t lbd) {
+    assert(clause.size() <= MAX_SIZE);
+    Ring &ring = *rings[worker];
+    const uint64_t n = ring.head.load(std::memory_order_relaxed);
+    Slot &slot = ring.slots[n % CAPACITY];
+    // odd while writing
+    slot.seq.store(2 * n + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.size.store(static_cast<uint32_t>(clause.size()),
+                    std::memory_order_relaxed);
+    slot.lbd.store(lbd, std::memory_order_relaxed);
+    for (size_t i = 0; i < clause.size(); i++) {
+      slot.lits[i].store(clause[i].x, std::memory_order_relaxed);
+    }
+    slot.seq.store(2 * n + 2, std::memory_order_release);
+    ring.head.store(n + 1, std::memory_order_release);
+  }
+  // Call on_clause(clause, lbd) for each clause published by the other
+  // workers since the last call. cursors[w] is the next clause of worker w.
+  template <typename OnClause>
+  void collect(size_t worker, std::vector<uint64_t> &cursors, Clause &clause,
+               OnClause on_clause) {
+    cursors.resize(rings.size(), 0);
+    for (size_t w = 0; w < rings.size(); w++) {
+      if (w == worker) {
+        continue;
+      }
+      Ring &ring = *rings[w];
+      const uint64_t head = ring.head.load(std::memory_order_acquire);
+      uint64_t &cursor = cursors[w];
+      if (head - cursor > CAPACITY) {
+        // overwritten
+        cursor = head - CAPACITY;
+      }
+      for (; cursor < head; cursor++) {
+        Slot &slot = ring.slots[cursor % CAPACITY];
+        const uint64_t seq = slot.seq.load(std::memory_order_acquire);
+        if (seq != 2 * cursor + 2) {
+          continue;
+        }
+        const size_t size = std::min<size_t>(
+            slot.size.load(std::memory_order_relaxed), MAX_SIZE);
+        const uint32_t lbd = slot.lbd.load(std::memory_order_relaxed);
+        int raw[MAX_SIZE];
+        for (size_t i = 0; i < size; i++) {
+          raw[i] = slot.lits[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.seq.load(std::memory_order_relaxed) != seq) {
+          // overwritten while reading
+          continue;
+        }
+        clause.resize(size);
+        for (size_t i = 0; i < size; i++) {
+          clause[i] = Lit(Var(raw[i] >> 1), (raw[i] & 1) == 0);
+        }
+        on_clause(clause, lbd);
+      }
+    }
+  }
+
+private:
+  struct Slot {
+    std::atomic<uint64_t> seq{0};
+    std::atomic<uint32_t> size{0};
+    std::atomic<uint32_t> lbd{0};
+    std::atomic<int> lits[MAX_SIZE];
+  };
+  struct Ring {
+    // a cache line of its own
+    alignas(64) std::atomic<uint64_t> head{0};
+    std::vector<Slot> slots = std::vector<Slot>(CAPACITY);
+  };
+  std::vector<std::unique_ptr<Ring>> rings;
+};
+
+// An entry of a watch list.
+// `blocker` is another literal of the clause. If it is true, the clause is
+// satisfied and doesn't have to be visited.
+// For a binary clause, `blocker` is the other literal of the clause.
+struct Watcher {
+  CRef cref;
+  Lit blocker;
+};
+
+template <typename Config> class BasicSolver {
+public:
+  BasicSolver() = default;
+  explicit BasicSolver(size_t variable_num,
+                       const SolverOptions &opts = SolverOptions())
+      : options(opts), restart(opts), branching(opts), phases(opts),
+        walker(opts.seed) {
+    values.resize(2 * variable_num + VALUE_PADDING, LitBool::Undefine);
+    watchers.resize(2 * variable_num);
+    bin_watchers.resize(2 * variable_num);
+    reasons.resize(variable_num, CREF_UNDEF);
+    levels.resize(variable_num, 0);
+    lit_stamps.resize(2 * variable_num, 0);
+    seen.resize(variable_num);
+    eliminated.resize(variable_num, false);
+    frozen.resize(variable_num, false);
+    branching.reserve(variable_num);
+    for (size_t v = 0; v < variable_num; v++) {
+      branching.new_var(Var(v));
+      phases.new_var();
+    }
+  }
+  // Start over as BasicSolver(variable_num, opts), but keep the memory of
+  // the clause arena, the watch lists and the other buffers for the next
+  // formula.
+  void reset(size_t variable_num, const SolverOptions &opts) {
+    ca.clear();
+    for (auto *cls :
+         {&clauses, &learnts_core, &learnts_tier2, &learnts_local}) {
+      cls->clear();
+    }
+    // Watch lists beyond num_vars() stay empty until new_var().
+    for (auto *ws : {&watchers, &bin_watchers}) {
+      for (std::vector<Watcher> &watcher : *ws) {
+        watcher.clear();
+      }
+    }
+    values.assign(VALUE_PADDING, LitBool::Undefine);
+    reasons.clear();
+    levels.clear();
+    seen.clear();
+    skip_simplify = false;
+    trail.clear();
+    trail_lim.clear();
+    que_head = 0;
+    cla_bump_inc = 1.0;
+    options = opts;
+    restart = BasicRestartScheduler<Config>(opts);
+    branching = BasicBranching<Config>(opts);
+    phases = Phases(opts);
+    level_stamps.clear();
+    lbd_stamp = 0;
+    lit_stamps.clear();
+    lit_stamp = 0;
+    preprocessed = false;
+    eliminated.clear();
+    frozen.clear();
+    occs.clear();
+    touched.clear();
+    subsume_queue.clear();
+    resolvents.clear();
+    occ_head = 0;
+    steps = 0;
+    elim_lits.clear();
+    elim_sizes.clear();
+    next_inprocess = opts.inprocess_interval;
+    inprocess_propagations = 0;
+    walker.reseed(opts.seed);
+    next_walk = 0;
+    walk_propagations = 0;
+    exchange = nullptr;
+    exchange_id = 0;
+    exchange_cursors.clear();
+    interrupted.store(false, std::memory_order_relaxed);
+    proof = nullptr;
+    proof_units = 0;
+    input_lits.clear();
+    input_sizes.clear();
+    set_budget(Budget());
+    progress = nullptr;
+    assings.clear();
+    status = std::nullopt;
+    failed_assumptions.clear();
+    stats = Stats();
+    branching.reserve(variable_num);
+    new_vars(variable_num);
+  }
+  [[nodiscard]] size_t num_vars() const { return levels.size(); }
+  // Grow the number of variables to var_num.
+  void new_vars(size_t var_num) {
+    while (num_vars() < var_num) {
+      new_var();
+    }
+  }
+  [[nodiscard]] LitBool eval(Lit lit) const { return values[lit.lidx()]; }
+  [[nodiscard]] int decision_level() const {
+    return static_cast<int>(trail_lim.size());
+  }
+  void new_decision(Lit lit) {
+    trail_lim.push_back(trail.size());
+    enqueue(lit);
+  }
+
+  void enqueue(Lit lit, CRef reason = CREF_UNDEF) {
+    enqueue_at(lit, reason, decision_level());
+  }
+  // With chronological backtracking, an implication can be below the
+  // current level.
+  void enqueue_at(Lit lit, CRef reason, int level) {
+    assert(eval(lit) == LitBool::Undefine);
+    values[lit.lidx()] = LitBool::True;
+    values[(~lit).lidx()] = LitBool::False;
+    levels[lit.vidx()] = level;
+    reasons[lit.vidx()] = reason;
+    trail.push_back(lit);
+  }
+
+  // Literals of lower levels assigned out of order (see enqueue_at()) stay
+  // on the trail and are propagated again.
+  void pop_queue_until(int until_level, bool save_phases = true) {
+    if (decision_level() <= until_level) {
+      return;
+    }
+    const size_t until = trail_lim[static_cast<size_t>(until_level)];
+    // Rebuilding the heap is cheaper than pushing many variables back.
+    const bool rebuild =
+        (trail.size() - until) * HEAP_REBUILD_RATIO > num_vars();
+    size_t kept = until;
+    for (size_t i = until; i < trail.size(); i++) {
+      const Lit lit = trail[i];
+      if (options.chrono && levels[lit.vidx()] <= until_level) {
+        trail[kept++] = lit;
+        continue;
+      }
+      if (!rebuild) {
+        branching.on_unassign(lit.var());
+      }
+      if (save_phases) {
+        phases.save(lit);
+      }
+      values[lit.lidx()] = LitBool::Undefine;
+      values[(~lit).lidx()] = LitBool::Undefine;
+      reasons[lit.vidx()] = CREF_UNDEF;
+    }
+    trail.resize(kept);
+    trail_lim.resize(static_cast<size_t>(until_level));
+    que_head = until;
+    if (rebuild) {
+      branching.rebuild(num_vars(), [&](Var x) {
+        return eval(Lit(x, true)) != LitBool::Undefine ||
+               eliminated[static_cast<size_t>(x)];
+      });
+    }
+  }
+  void new_var() {
+    // literal index
+    Var v = Var(num_vars());
+    // Watch lists emptied by reset() are reused.
+    if (watchers.size() <= 2 * static_cast<size_t>(v)) {
+      watchers.push_back(std::vector<Watcher>());
+      watchers.push_back(std::vector<Watcher>());
+      bin_watchers.push_back(std::vector<Watcher>());
+      bin_watchers.push_back(std::vector<Watcher>());
+    }
+    // The padding is undefined too, so appending keeps it at the end.
+    values.push_back(LitBool::Undefine);
+    values.push_back(LitBool::Undefine);
+    // variable index
+    seen.push_back(false);
+    eliminated.push_back(false);
+    frozen.push_back(false);
+    reasons.push_back(CREF_UNDEF);
+    levels.push_back(0);
+    lit_stamps.push_back(0);
+    lit_stamps.push_back(0);
+    branching.new_var(v);
+    phases.new_var();
+  }
+  std::vector<std::vector<Watcher>> &watch_list(CRef cr) {
+    return ca[cr].size() == 2 ? bin_watchers : watchers;
+  }
+  void unwatch_clause(CRef cr) {
+    ArenaClause clause = ca[cr];
+    assert(clause.size() > 1);
+    std::vector<std::vector<Watcher>> &ws = watch_list(cr);
+    for (const auto idx : {0, 1}) {
+      std::vector<Watcher> &watcher =
+          ws[(~clause[static_cast<size_t>(idx)]).lidx()];
+
+      for (size_t i = 0; i < watcher.size(); i++) {
+        if (watcher[i].cref == cr) {
+          watcher[i] = watcher.back();
+          watcher.pop_back();
+          break;
+        }
+      }
+    }
+    return;
+  }
+  void watch_clause(CRef cr) {
+    ArenaClause clause = ca[cr];
+    assert(clause.size() > 1);
+    std::vector<std::vector<Watcher>> &ws = watch_list(cr);
+    ws[(~clause[0]).lidx()].push_back(Watcher{cr, clause[1]});
+    ws[(~clause[1]).lidx()].push_back(Watcher{cr, clause[0]});
+  }
+  void attach_clause(CRef cr) {
+    assert(ca[cr].size() > 1);
+    watch_clause(cr);
+    if (ca[cr].learnt()) {
+      learnts_of(ca[cr].tier()).push_back(cr);
+    } else {
+      clauses.push_back(cr);
+    }
+  }
+  CRef add_learnt_clause(const Clause &clause, uint32_t lbd) {
+    stats.learnts_added++;
+    CRef cr = ca.alloc(clause, true);
+    ca[cr].set_lbd(lbd);
+    ca[cr].set_tier(tier_of(lbd));
+    attach_clause(cr);
+    return cr;
+  }
+  std::vector<CRef> &learnts_of(Tier tier) {
+    switch (tier) {
+    case Tier::Core:
+      return learnts_core;
+    case Tier::Tier2:
+      return learnts_tier2;
+    case Tier::Local:
+      break;
+    }
+    return learnts_local;
+  }
+  [[nodiscard]] Tier tier_of(uint32_t lbd) const {
+    if (lbd <= options.core_lbd) {
+      return Tier::Core;
+    }
+    return lbd <= options.tier2_lbd ? Tier::Tier2 : Tier::Local;
+  }
+  [[nodiscard]] size_t num_learnts() const {
+    return learnts_core.size() + learnts_tier2.size() + learnts_local.size();
+  }
+  // Detach a clause and release its arena memory.
+  // `clauses` and learnts have to be updated by a caller.
+  void remove_clause(CRef cr) {
+    if (ca[cr].learnt()) {
+      stats.learnts_deleted++;
+    }
+    if (logging_proof()) {
+      add_proof_units();
+      proof->remove(ca[cr].begin(), ca[cr].end());
+    }
+    unwatch_clause(cr);
+    ca.free(cr);
+  }
+  ArenaClause clause_at(CRef cr) { return ca[cr]; }
+
+  // Clauses can be added between solve() calls, the model of the last call
+  // is lost from the trail but kept in `assings`.
+  void add_clause(const Clause &clause) {
+    if (options.keep_input_clauses) {
+      input_lits.insert(input_lits.end(), clause.begin(), clause.end());
+      input_sizes.push_back(clause.size());
+    }
+    insert_clause(clause);
+  }
+  // Write the irredundant clauses with the top-level assignments as a
+  // snapshot, after preprocessing if options.preprocess. Learnt clauses are
+  // left out.
+  void write_snapshot(std::ostream &os) {
+    pop_queue_until(0);
+    if (!status && options.preprocess && !preprocessed && !preprocess()) {
+      refuted();
+    }
+    auto word = [](size_t n) {
+      assert(n <= std::numeric_limits<uint32_t>::max());
+      return static_cast<uint32_t>(n);
+    };
+    std::vector<uint32_t> units, offsets, arena, elim_vars;
+    for (const Lit lit : trail) {
+      units.push_back(word(lit.lidx()));
+    }
+    for (const CRef cr : clauses) {
+      ArenaClause clause = ca[cr];
+      if (clause.deleted()) {
+        continue;
+      }
+      offsets.push_back(word(arena.size()));
+      arena.push_back(word(clause.size()));
+      arena.insert(arena.end(), ArenaClause::HEADER_WORDS - 1, 0);
+      for (const Lit lit : clause) {
+        arena.push_back(word(lit.lidx()));
+      }
+    }
+    for (size_t v = 0; v < num_vars(); v++) {
+      if (eliminated[v]) {
+        elim_vars.push_back(word(v));
+      }
+    }
+    std::vector<uint32_t> elim_clauses, elim_words;
+    for (const size_t size : elim_sizes) {
+      elim_clauses.push_back(word(size));
+    }
+    for (const Lit lit : elim_lits) {
+      elim_words.push_back(word(lit.lidx()));
+    }
+    SnapshotHeader header = {};
+    header.version = SNAPSHOT_VERSION;
+    header.flags = (preprocessed ? SnapshotHeader::PREPROCESSED : 0) |
+                   (status == Status::Unsat ? SnapshotHeader::UNSAT : 0);
+    header.var_num = word(num_vars());
+    header.units = word(units.size());
+    header.clauses = word(offsets.size());
+    header.arena_words = word(arena.size());
+    header.elim_vars = word(elim_vars.size());
+    header.elim_clauses = word(elim_clauses.size());
+    header.elim_lits = word(elim_words.size());
+    os.write(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    os.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    for (const auto *section :
+         {&units, &offsets, &arena, &elim_vars, &elim_clauses, &elim_words}) {
+      os.write(reinterpret_cast<const char *>(section->data()),
+               static_cast<std::streamsize>(section->size() *
+                                            sizeof(uint32_t)));
+    }
+    os.flush();
+  }
+  // Load a snapshot of write_snapshot() into an empty solver. The clauses
+  // are copied into the arena at once and watched in place. With
+  // keep_input_clauses, the units and the clauses of the snapshot become the
+  // input for check_model().
+  std::optional<std::string> load_snapshot(const char *data, size_t size) {
+    if (num_vars() > 0 || !clauses.empty()) {
+      return "a snapshot needs an empty solver";
+    }
+    if (logging_proof()) {
+      return "a proof needs DIMACS input";
+    }
+    constexpr size_t HEADER_BYTES =
+        sizeof(SNAPSHOT_MAGIC) + sizeof(SnapshotHeader);
+    if (!is_snapshot(data, size) || size < HEADER_BYTES) {
+      return "not a snapshot";
+    }
+    SnapshotHeader header;
+    std::memcpy(&header, data + sizeof(SNAPSHOT_MAGIC), sizeof(header));
+    if (header.version != SNAPSHOT_VERSION) {
+      return "unsupported snapshot version " + std::to_string(header.version);
+    }
+    const size_t words = size_t{header.units} + header.clauses +
+                         header.arena_words + header.elim_vars +
+                         header.elim_clauses + header.elim_lits;
+    const std::string corrupt = "corrupt snapshot";
+    if (size != HEADER_BYTES + words * sizeof(uint32_t) ||
+        header.var_num > MAX_SNAPSHOT_VARS ||
+        header.arena_words >= CREF_UNDEF) {
+      return corrupt;
+    }
+    const char *cur = data + HEADER_BYTES;
+    auto take = [&](size_t i) {
+      uint32_t w;
+      std::memcpy(&w, cur + i * sizeof(uint32_t), sizeof(w));
+      return w;
+    };
+    const size_t lit_num = 2 * size_t{header.var_num};
+    auto take_lit = [&](size_t i) -> std::optional<Lit> {
+      const uint32_t w = take(i);
+      if (w >= lit_num) {
+        return std::nullopt;
+      }
+      Lit lit;
+      lit.x = static_cast<int>(w);
+      return lit;
+    };
+    new_vars(header.var_num);
+    for (size_t i = 0; i < header.units; i++) {
+      const std::optional<Lit> lit = take_lit(i);
+      if (!lit) {
+        return corrupt;
+      }
+      if (options.keep_input_clauses) {
+        input_lits.push_back(lit.value());
+        input_sizes.push_back(1);
+      }
+      if (eval(lit.value()) == LitBool::False) {
+        status = Status::Unsat;
+      } else if (eval(lit.value()) == LitBool::Undefine) {
+        enqueue(lit.value());
+      }
+    }
+    cur += header.units * sizeof(uint32_t);
+    const char *offsets = cur;
+    cur += header.clauses * sizeof(uint32_t);
+    const CRef base = ca.append(cur, header.arena_words);
+    // The clauses are packed in order and cover the arena words exactly.
+    size_t next_offset = 0;
+    for (size_t i = 0; i < header.clauses; i++) {
+      uint32_t offset;
+      std::memcpy(&offset, offsets + i * sizeof(uint32_t), sizeof(offset));
+      if (offset != next_offset ||
+          next_offset + ArenaClause::HEADER_WORDS > header.arena_words) {
+        return corrupt;
+      }
+      const CRef cr = base + offset;
+      ArenaClause clause = ca[cr];
+      next_offset += ArenaClause::HEADER_WORDS + size_t{clause.size()};
+      if (clause.size() < 2 || clause.learnt() || clause.deleted() ||
+          next_offset > header.arena_words ||
+          std::any_of(clause.begin(), clause.end(), [&](Lit lit) {
+            return static_cast<uint32_t>(lit.x) >= lit_num;
+          })) {
+        return corrupt;
+      }
+      if (options.keep_input_clauses) {
+        input_lits.insert(input_lits.end(), clause.begin(), clause.end());
+        input_sizes.push_back(clause.size());
+      }
+      attach_clause(cr);
+    }
+    if (next_offset != header.arena_words) {
+      return corrupt;
+    }
+    cur += header.arena_words * sizeof(uint32_t);
+    for (size_t i = 0; i < header.elim_vars; i++) {
+      const uint32_t v = take(i);
+      if (v >= header.var_num) {
+        return corrupt;
+      }
+      eliminated[v] = true;
+    }
+    cur += header.elim_vars * sizeof(uint32_t);
+    size_t elim_total = 0;
+    for (size_t i = 0; i < header.elim_clauses; i++) {
+      // extend_model() and restore_var() read the first literal of each
+      if (take(i) == 0) {
+        return corrupt;
+      }
+      elim_sizes.push_back(take(i));
+      elim_total += elim_sizes.back();
+    }
+    cur += header.elim_clauses * sizeof(uint32_t);
+    if (elim_total != header.elim_lits) {
+      return corrupt;
+    }
+    for (size_t i = 0; i < header.elim_lits; i++) {
+      const std::optional<Lit> lit = take_lit(i);
+      if (!lit) {
+        return corrupt;
+      }
+      elim_lits.push_back(lit.value());
+    }
+    // A clause removed by an elimination starts with the eliminated variable.
+    size_t elim_begin = 0;
+    for (const size_t elim_size : elim_sizes) {
+      if (!eliminated[elim_lits[elim_begin].vidx()]) {
+        return corrupt;
+      }
+      elim_begin += elim_size;
+    }
+    preprocessed = (header.flags & SnapshotHeader::PREPROCESSED) != 0;
+    if ((header.flags & SnapshotHeader::UNSAT) != 0) {
+      status = Status::Unsat;
+    }
+    return std::nullopt;
+  }
+  // Whether `assings` satisfies every input clause. Requires
+  // keep_input_clauses.
+  [[nodiscard]] bool check_model() const {
+    assert(options.keep_input_clauses);
+    const std::vector<LitBool> model = model_values(assings, num_vars());
+    const Lit *lits = input_lits.data();
+    for (const size_t size : input_sizes) {
+      if (find_value<true>(lits, size, model.data(), LitBool::True) == size) {
+        return false;
+      }
+      lits += size;
+    }
+    return true;
+  }
+  void insert_clause(const Clause &clause) {
+    pop_queue_until(0);
+    // grow the size
+    std::for_each(clause.begin(), clause.end(), [&](Lit lit) {
+      new_vars(lit.vidx() + 1);
+      if (eliminated[lit.vidx()]) {
+        restore_var(lit.var());
+      }
+    });
+    // restore_var() above is done with the scratch by now.
+    Clause &ps = add_buf;
+    ps.assign(clause.begin(), clause.end());
+    size_t new_len = 0;
+    std::sort(ps.begin(), ps.end());
+    for (size_t i = 0; i < ps.size(); i++) {
+      if (eval(ps[i]) == LitBool::True) {
+        return;
+      }
+      if (i >= 1) {
+        if (ps[i] == ~ps[i - 1]) {
+          return;
+        }
+        if (ps[i] == ps[i - 1]) {
+          continue;
+        }
+      }
+      if (eval(ps[i]) != LitBool::False) {
+        ps[new_len++] = ps[i];
+      }
+    }
+    ps.resize(new_len);
+    if (logging_proof() && ps.size() < clause.size()) {
+      proof->add(ps.begin(), ps.end());
+    }
+    if (ps.empty()) {
+      status = Status::Unsat;
+    } else if (ps.size() == 1) {
+      // Unit Clause
+      enqueue(ps[0]);
+    } else {
+      CRef cr = ca.alloc(ps, false);
+      attach_clause(cr);
+    }
+  }
+  [[nodiscard]] std::optional<CRef> propagate() {
+    ScopedTimer<Config::profile> scoped_timer(stats.propagate_seconds);
+    while (que_head < trail.size()) {
+      const Lit lit = trail[que_head++];
       const Lit nlit = ~lit;
+      // below decision_level() only with chronological backtracking
+      const int lit_level = levels[lit.vidx()];
+      stats.propagations++;
+
+      // Binary clauses are propagated from their watchers only.
+      for (const Watcher &w : bin_watchers[lit.lidx()]) {
+        const LitBool value = eval(w.blocker);
+        if (value == LitBool::True) {
+          continue;
+        }
+        if (value == LitBool::False) {
+          // Conflict
+          return w.cref;
+        }
+        enqueue_at(w.blocker, w.cref, lit_level);
+      }
 
-      std::vector<CWRef> &watcher = watchers[lit.lidx()];
-      for (size_t i = 0; i < watcher.size();) {
-        assert(!watcher[i].expired());
-        CRef cr = watcher[i].lock();
-        const size_t next_idx = i + 1;
-        Clause &clause = *cr;
+      std::vector<Watcher> &watcher = watchers[lit.lidx()];
+      size_t i = 0, j = 0;
+      while (i < watcher.size()) {
+        // Already satisfied by a blocker
+        // No need to look at the clause.
+        if (eval(watcher[i].blocker) == LitBool::True) {
+          watcher[j++] = watcher[i++];
+          continue;
+        }
+        const CRef cr = watcher[i].cref;
+        i++;
+        ArenaClause clause = ca[cr];
 
         assert(clause[0] == nlit || clause[1] == nlit);
         // make sure that the clause[1] it false.
@@ -364,340 +2152,2650 @@ public:
         }
         assert(clause[1] == nlit && eval(clause[1]) == LitBool::False);
 
-        Lit first = clause[0];
+        const Lit first = clause[0];
+        const Watcher w = Watcher{cr, first};
         // Already satisfied
         if (eval(first) == LitBool::True) {
-          i = next_idx;
+          watcher[j++] = w;
           goto nextclause;
         }
         // clause[0] is False or Undefine
         // clause[1] is False
         // clause[2..] is False or True or Undefine.
 
-        for (size_t k = 2; k < clause.size(); k++) {
-          // Found a new lit to watch
-          if (eval(clause[k]) != LitBool::False) {
+        {
+          const size_t k = 2 + find_value<false>(&clause[2], clause.size() - 2,
+                                                 values.data(), LitBool::False);
+          if (k < clause.size()) {
+            // Found a new lit to watch
             std::swap(clause[1], clause[k]);
-            // Remove a value(swap the last one and pop back)
-            watcher[i] = watcher.back();
-            watcher.pop_back();
             // New watch
-            watchers[(~clause[1]).lidx()].push_back(cr);
+            watchers[(~clause[1]).lidx()].push_back(w);
             goto nextclause;
           }
         }
 
         // clause[2..] is False
+        watcher[j++] = w;
         if (eval(first) == LitBool::False) {
           // All literals are false
           // Conflict
-          return std::move(cr);
+          while (i < watcher.size()) {
+            watcher[j++] = watcher[i++];
+          }
+          watcher.resize(j);
+          return cr;
         } else {
           // All literals excepting first are false
           // Unit Propagation
           assert(eval(first) == LitBool::Undefine);
-          enqueue(first, cr);
-          i = next_idx;
+          int level = lit_level;
+          if (level < decision_level()) {
+            // The implication is at the highest level of the other
+            // literals, and that literal is watched instead.
+            size_t highest = 1;
+            for (size_t k = 2; k < clause.size(); k++) {
+              if (levels[clause[k].vidx()] > level) {
+                level = levels[clause[k].vidx()];
+                highest = k;
+              }
+            }
+            if (highest != 1) {
+              std::swap(clause[1], clause[highest]);
+              j--;
+              watchers[(~clause[1]).lidx()].push_back(w);
+            }
+          }
+          enqueue_at(first, cr, level);
         }
       nextclause:;
       }
+      watcher.resize(j);
+    }
+
+    return std::nullopt;
+  }
+
+  // After chronological backtracking, every literal of a conflict can be
+  // below the current level. Move the two literals of the highest levels
+  // to the watches and return the highest level.
+  int conflict_level(CRef conflict) {
+    ArenaClause clause = ca[conflict];
+    auto level = [&](size_t i) { return levels[clause[i].vidx()]; };
+    size_t highest = 0;
+    for (size_t i = 1; i < clause.size(); i++) {
+      if (level(i) > level(highest)) {
+        highest = i;
+      }
+    }
+    size_t second = highest == 0 ? 1 : 0;
+    for (size_t i = 0; i < clause.size(); i++) {
+      if (i != highest && level(i) > level(second)) {
+        second = i;
+      }
+    }
+    if (highest > 1 || second > 1) {
+      const bool watched = clause.size() > 2;
+      if (watched) {
+        unwatch_clause(conflict);
+      }
+      std::swap(clause[0], clause[highest]);
+      std::swap(clause[1], clause[second == 0 ? highest : second]);
+      if (watched) {
+        watch_clause(conflict);
+      }
+    } else if (highest == 1) {
+      std::swap(clause[0], clause[1]);
+    }
+    return level(0);
+  }
+
+  // Collect the assumptions that imply ~lit for a false assumption `lit`.
+  // Every decision on the trail is an assumption here.
+  void analyze_final(Lit lit) {
+    failed_assumptions.push_back(lit);
+    if (levels[lit.vidx()] == 0) {
+      return;
+    }
+    seen[lit.vidx()] = true;
+    for (size_t i = trail.size(); i-- > trail_lim[0];) {
+      const Lit implied = trail[i];
+      if (!seen[implied.vidx()]) {
+        continue;
+      }
+      seen[implied.vidx()] = false;
+      const CRef reason = reasons[implied.vidx()];
+      if (reason == CREF_UNDEF) {
+        failed_assumptions.push_back(implied);
+        continue;
+      }
+      for (const Lit other : ca[reason]) {
+        if (other.var() != implied.var() && levels[other.vidx()] > 0) {
+          seen[other.vidx()] = true;
+        }
+      }
+    }
+  }
+  // Learnt clause, back jump level and LBD
+  // The learnt clause is kept in a scratch buffer until the next call.
+  [[nodiscard]] std::tuple<const Clause &, int, uint32_t>
+  analyze(CRef conflict) {
+    ScopedTimer<Config::profile> scoped_timer(stats.analyze_seconds);
+    Clause &learnt_clause = learnt_buf;
+    learnt_clause.clear();
+    assert([&]() {
+      bool ok = false;
+      for (const bool b : seen) {
+        ok |= b;
+      }
+      return !ok;
+    }());
+    const int conflicted_decision_level = decision_level();
+    analyze_bumped.clear();
+
+    int counter = 0;
+    {
+      ArenaClause clause = ca[conflict];
+      use_clause(conflict);
+
+      // variables that are used to traverse by a conflicted clause
+      for (const Lit lit : clause) {
+        assert(eval(lit) == LitBool::False);
+        // Top-level assignments are never needed.
+        if (levels[lit.vidx()] == 0) {
+          continue;
+        }
+        seen[lit.vidx()] = true;
+        analyze_bumped.push_back(lit.var());
+        if (levels[lit.vidx()] < conflicted_decision_level) {
+          learnt_clause.emplace_back(lit);
+        } else {
+          counter += 1;
+        }
+      }
+      assert(counter >= 1);
+    }
+
+    // traverse a implication graph to a 1-UIP(first-uinque-implication-point)
+    std::optional<Lit> first_uip = std::nullopt;
+    for (size_t i = trail.size() - 1; true; i--) {
+      Lit lit = trail[i];
+      // Skip a variable that isn't checked. A lower level can be among the
+      // conflicted one after chronological backtracking.
+      if (!seen[lit.vidx()] || levels[lit.vidx()] < conflicted_decision_level) {
+        continue;
+      }
+      counter--;
+      if (counter <= 0) {
+        // 1-UIP
+        first_uip = lit;
+        break;
+      }
+      seen[lit.vidx()] = false;
+
+      assert(reasons[lit.vidx()] != CREF_UNDEF);
+      ArenaClause clause = ca[reasons[lit.vidx()]];
+      use_clause(reasons[lit.vidx()]);
+      // A binary clause doesn't keep the propagated literal at first.
+      if (clause.size() == 2 && clause[0] != lit) {
+        std::swap(clause[0], clause[1]);
+      }
+      assert(clause[0] == lit);
+      for (size_t j = 1; j < clause.size(); j++) {
+        Lit clit = clause[j];
+        // Already checked
+        if (seen[clit.vidx()] || levels[clit.vidx()] == 0) {
+          continue;
+        }
+        seen[clit.vidx()] = true;
+        analyze_bumped.push_back(clit.var());
+        if (levels[clit.vidx()] < conflicted_decision_level) {
+          learnt_clause.push_back(clit);
+        } else {
+          counter += 1;
+        }
+      }
+    }
+    assert(first_uip.has_value());
+    // learnt_clause[0] = !first_uip
+    learnt_clause.push_back(~(first_uip.value()));
+    std::swap(learnt_clause[0], learnt_clause.back());
+
+    branching.bump_all(analyze_bumped);
+
+    // seen[v] is true for all variables in learnt_clause.
+    analyze_toclear = learnt_clause;
+    if (options.minimize) {
+      minimize_learnt(learnt_clause);
+    }
+    for (const Lit &lit : analyze_toclear) {
+      seen[lit.vidx()] = false;
+    }
+    uint32_t lbd = compute_lbd(learnt_clause);
+    if (options.binary_minimize && lbd <= options.binary_minimize_lbd) {
+      binary_minimize_learnt(learnt_clause);
+      lbd = compute_lbd(learnt_clause);
+    }
+
+    // Back Jump
+    // learnt_clause[1] has the highest level of the rest so that it can be
+    // watched.
+    int back_jump_level = 0;
+    for (size_t i = 1; i < learnt_clause.size(); i++) {
+      if (levels[learnt_clause[i].vidx()] > back_jump_level) {
+        back_jump_level = levels[learnt_clause[i].vidx()];
+        std::swap(learnt_clause[1], learnt_clause[i]);
+      }
+    }
+
+    return {learnt_clause, back_jump_level, lbd};
+  }
+  [[nodiscard]] uint32_t abstract_level(Var v) const {
+    return 1u << (static_cast<uint32_t>(levels[static_cast<size_t>(v)]) & 31);
+  }
+  // Remove a literal whose negation is implied by the other literals.
+  // Requires seen[v] to be true for all variables in the clause.
+  void minimize_learnt(Clause &learnt_clause) {
+    // decision levels in the clause (as a bloom filter)
+    uint32_t abstract_levels = 0;
+    for (size_t i = 1; i < learnt_clause.size(); i++) {
+      abstract_levels |= abstract_level(learnt_clause[i].var());
+    }
+    size_t new_size = 1;
+    for (size_t i = 1; i < learnt_clause.size(); i++) {
+      const Lit lit = learnt_clause[i];
+      if (reasons[lit.vidx()] == CREF_UNDEF ||
+          !lit_redundant(lit, abstract_levels)) {
+        learnt_clause[new_size++] = lit;
+      }
+    }
+    learnt_clause.resize(new_size);
+  }
+  // Is every path from `p` in the implication graph reaching literals of a
+  // learnt clause?
+  bool lit_redundant(Lit p, uint32_t abstract_levels) {
+    analyze_stack.clear();
+    analyze_stack.push_back(p);
+    const size_t top = analyze_toclear.size();
+    while (!analyze_stack.empty()) {
+      const Lit q = analyze_stack.back();
+      analyze_stack.pop_back();
+      assert(reasons[q.vidx()] != CREF_UNDEF);
+      ArenaClause clause = ca[reasons[q.vidx()]];
+      if (clause.size() == 2 && clause[0] != ~q) {
+        std::swap(clause[0], clause[1]);
+      }
+      assert(clause[0] == ~q);
+      for (size_t i = 1; i < clause.size(); i++) {
+        const Lit lit = clause[i];
+        if (seen[lit.vidx()] || levels[lit.vidx()] == 0) {
+          continue;
+        }
+        if (reasons[lit.vidx()] != CREF_UNDEF &&
+            (abstract_level(lit.var()) & abstract_levels) != 0) {
+          seen[lit.vidx()] = true;
+          analyze_stack.push_back(lit);
+          analyze_toclear.push_back(lit);
+        } else {
+          // Reached a decision or a level that isn't in the clause.
+          for (size_t j = top; j < analyze_toclear.size(); j++) {
+            seen[analyze_toclear[j].vidx()] = false;
+          }
+          analyze_toclear.resize(top);
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+  // (learnt[0] v lit v ...) and (learnt[0] v ~lit) => (learnt[0] v ...)
+  void binary_minimize_learnt(Clause &learnt_clause) {
+    lit_stamp++;
+    for (size_t i = 1; i < learnt_clause.size(); i++) {
+      lit_stamps[learnt_clause[i].lidx()] = lit_stamp;
+    }
+    bool removed = false;
+    // binary clauses that contain learnt[0]
+    for (const Watcher &w : bin_watchers[(~learnt_clause[0]).lidx()]) {
+      const Lit lit = ~w.blocker;
+      if (lit_stamps[lit.lidx()] == lit_stamp) {
+        lit_stamps[lit.lidx()] = 0;
+        removed = true;
+      }
+    }
+    if (!removed) {
+      return;
+    }
+    size_t new_size = 1;
+    for (size_t i = 1; i < learnt_clause.size(); i++) {
+      if (lit_stamps[learnt_clause[i].lidx()] == lit_stamp) {
+        learnt_clause[new_size++] = learnt_clause[i];
+      }
+    }
+    learnt_clause.resize(new_size);
+  }
+  // A learnt clause takes part in a conflict.
+  void use_clause(CRef cr) {
+    ArenaClause clause = ca[cr];
+    if (!clause.learnt()) {
+      return;
+    }
+    clause.set_used(true);
+    clause_bump_activity(clause);
+    if (clause.tier() == Tier::Core) {
+      return;
+    }
+    const uint32_t lbd = compute_lbd(clause);
+    if (lbd < clause.lbd()) {
+      // It moves to a better tier at the next reduction.
+      clause.set_lbd(lbd);
+      if (tier_of(lbd) < clause.tier()) {
+        clause.set_tier(tier_of(lbd));
+      }
+    }
+  }
+  void clause_bump_activity(ArenaClause clause) {
+    clause.set_activity(clause.activity() + static_cast<float>(cla_bump_inc));
+    if (clause.activity() > 1e20f) {
+      // rescale, Core too since use_clause() bumps every learnt clause
+      for (auto *learnts : {&learnts_core, &learnts_tier2, &learnts_local}) {
+        for (const CRef cr : *learnts) {
+          ca[cr].set_activity(ca[cr].activity() * 1e-20f);
+        }
+      }
+      cla_bump_inc *= 1e-20;
+    }
+  }
+  // LBD(literal block distance) is the number of distinct decision levels in
+  // a clause.
+  template <typename Lits> [[nodiscard]] uint32_t compute_lbd(Lits &&clause) {
+    if (level_stamps.size() <= static_cast<size_t>(decision_level())) {
+      level_stamps.resize(static_cast<size_t>(decision_level()) + 1, 0);
+    }
+    lbd_stamp++;
+    uint32_t lbd = 0;
+    for (const Lit lit : clause) {
+      const size_t level = static_cast<size_t>(levels[lit.vidx()]);
+      if (level_stamps[level] != lbd_stamp) {
+        level_stamps[level] = lbd_stamp;
+        lbd++;
+      }
+    }
+    return lbd;
+  }
+  bool locked(CRef cr) {
+    ArenaClause clause = ca[cr];
+    // A clause is being propagated.
+    // A propagated literal of a binary clause may be the second one.
+    const size_t n = clause.size() == 2 ? 2 : 1;
+    for (size_t i = 0; i < n; i++) {
+      if (eval(clause[i]) == LitBool::True &&
+          reasons[clause[i].vidx()] == cr) {
+        return true;
+      }
+    }
+    return false;
+  }
+  void reduce_learnts() {
+    ScopedTimer<Config::profile> scoped_timer(stats.reduce_seconds);
+    stats.reductions++;
+    // Tier2 clauses that haven't been used since the last reduction become
+    // local.
+    size_t new_size = 0;
+    for (const CRef cr : learnts_tier2) {
+      ArenaClause clause = ca[cr];
+      if (clause.tier() == Tier::Core) {
+        learnts_core.push_back(cr);
+        continue;
+      }
+      if (!clause.used()) {
+        clause.set_tier(Tier::Local);
+        learnts_local.push_back(cr);
+        continue;
+      }
+      clause.set_used(false);
+      learnts_tier2[new_size++] = cr;
+    }
+    learnts_tier2.resize(new_size);
+
+    new_size = 0;
+    for (const CRef cr : learnts_local) {
+      ArenaClause clause = ca[cr];
+      if (clause.tier() != Tier::Local) {
+        // promoted by use_clause()
+        clause.set_used(false);
+        learnts_of(clause.tier()).push_back(cr);
+      } else {
+        learnts_local[new_size++] = cr;
+      }
+    }
+    learnts_local.resize(new_size);
+
+    // Evict the less active half of local clauses.
+    std::sort(learnts_local.begin(), learnts_local.end(),
+              [&](CRef left, CRef right) {
+                return ca[left].activity() > ca[right].activity();
+              });
+    new_size = learnts_local.size() / 2;
+    for (size_t i = new_size; i < learnts_local.size(); i++) {
+      const CRef cr = learnts_local[i];
+      if (ca[cr].size() > 2 && !ca[cr].used() && !locked(cr)) {
+        remove_clause(cr);
+      } else {
+        ca[cr].set_used(false);
+        learnts_local[new_size++] = cr;
+      }
+    }
+    learnts_local.resize(new_size);
+    check_garbage();
+  }
+  // Compact the arena if too much of it is occupied by deleted clauses.
+  void check_garbage() {
+    if (static_cast<double>(ca.wasted()) >
+        static_cast<double>(ca.size()) * GARBAGE_FRAC) {
+      garbage_collect();
+    }
+  }
+  void garbage_collect() {
+    ClauseArena to;
+    to.reserve(ca.size() - ca.wasted());
+    // clauses and learnts hold every live clause.
+    for (CRef &cr : clauses) {
+      ca.reloc(cr, to);
+    }
+    for (auto *learnts : {&learnts_core, &learnts_tier2, &learnts_local}) {
+      for (CRef &cr : *learnts) {
+        ca.reloc(cr, to);
+      }
+    }
+    for (auto *ws : {&watchers, &bin_watchers}) {
+      for (std::vector<Watcher> &watcher : *ws) {
+        for (Watcher &w : watcher) {
+          assert(!ca[w.cref].deleted());
+          ca.reloc(w.cref, to);
+        }
+      }
+    }
+    for (CRef &reason : reasons) {
+      if (reason == CREF_UNDEF) {
+        continue;
+      }
+      if (ca[reason].deleted()) {
+        // A reason of a top-level assignment can be removed by simplify().
+        reason = CREF_UNDEF;
+      } else {
+        ca.reloc(reason, to);
+      }
+    }
+    ca = std::move(to);
+  }
+  // Near the memory limit, reduce learnt clauses several times, lower
+  // `max_limit_learnts` of the search and free spare capacity. Returns false
+  // if the solver still needs more than the limit.
+  bool fit_memory(double &max_limit_learnts) {
+    stats.memory_bytes = memory_usage();
+    if (static_cast<double>(stats.memory_bytes) <=
+        static_cast<double>(memory_limit) * MEMORY_PRESSURE) {
+      return true;
+    }
+    stats.memory_reductions++;
+    for (int round = 0; round < MEMORY_REDUCE_ROUNDS; round++) {
+      reduce_learnts();
+    }
+    max_limit_learnts = std::min(
+        max_limit_learnts,
+        std::max(2.0 * static_cast<double>(learnts_local.size()),
+                 MIN_LEARNT_LIMIT));
+    garbage_collect();
+    for (auto *ws : {&watchers, &bin_watchers}) {
+      for (std::vector<Watcher> &watcher : *ws) {
+        if (watcher.capacity() > 2 * watcher.size()) {
+          watcher.shrink_to_fit();
+        }
+      }
+    }
+    for (auto *learnts : {&learnts_core, &learnts_tier2, &learnts_local}) {
+      learnts->shrink_to_fit();
+    }
+    walker.release();
+    stats.memory_bytes = memory_usage();
+    return stats.memory_bytes <= memory_limit;
+  }
+
+  void simplify() {
+    assert(decision_level() == 0);
+    stats.simplifications++;
+    auto remove_satisfied = [&](std::vector<CRef> &cls) {
+      // learnts
+      size_t new_cls_size = 0;
+      for (size_t i = 0; i < cls.size(); i++) {
+        CRef cr = cls[i];
+        ArenaClause clause = ca[cr];
+        const bool satisfied =
+            find_value<true>(clause.begin(), clause.size(), values.data(),
+                             LitBool::True) < clause.size();
+        if (satisfied) {
+          remove_clause(cr);
+        }
+
+        if (!satisfied) {
+          cls[new_cls_size] = cr;
+          new_cls_size++;
+        }
+      }
+      cls.resize(new_cls_size);
+    };
+
+    remove_satisfied(learnts_core);
+    remove_satisfied(learnts_tier2);
+    remove_satisfied(learnts_local);
+    remove_satisfied(clauses);
+    check_garbage();
+  }
+  // Preprocessing
+
+  // Simplify irredundant clauses before search with failed literal probing,
+  // subsumption, self-subsuming strengthening and bounded variable
+  // elimination. Returns false if the formula is unsatisfiable.
+  bool preprocess() {
+    assert(decision_level() == 0 && num_learnts() == 0);
+    preprocessed = true;
+    if (propagate() || !probe()) {
+      return false;
+    }
+    simplify();
+    occs.assign(num_vars(), {});
+    touched.assign(num_vars(), true);
+    for (const CRef cr : clauses) {
+      for (const Lit lit : ca[cr]) {
+        occs[lit.vidx()].push_back(cr);
+      }
+    }
+    // Small clauses subsume more.
+    subsume_queue = clauses;
+    std::stable_sort(subsume_queue.begin(), subsume_queue.end(),
+                     [&](CRef left, CRef right) {
+                       return ca[left].size() < ca[right].size();
+                     });
+    // Remove false literals as well.
+    occ_head = 0;
+    steps = 0;
+    const bool ok = propagate_units() && subsume() && eliminate();
+
+    occs = {};
+    touched = {};
+    subsume_queue = {};
+    purge_deleted();
+    check_garbage();
+    return ok;
+  }
+  // If propagating a literal leads to a conflict, its negation is implied.
+  bool probe() {
+    const uint64_t limit = stats.propagations + options.probe_limit;
+    // Literals implied by a successful probe don't fail either.
+    lit_stamp++;
+    for (size_t i = 0; i < 2 * num_vars(); i++) {
+      if (stats.propagations >= limit) {
+        break;
+      }
+      const Lit lit = Lit(Var(i / 2), i % 2 == 0);
+      // Only a literal with binary implications can propagate something.
+      if (eval(lit) != LitBool::Undefine || bin_watchers[i].empty() ||
+          lit_stamps[i] == lit_stamp) {
+        continue;
+      }
+      new_decision(lit);
+      const bool failed = propagate().has_value();
+      if (!failed) {
+        for (size_t j = trail_lim[0]; j < trail.size(); j++) {
+          lit_stamps[trail[j].lidx()] = lit_stamp;
+        }
+      }
+      pop_queue_until(0, false);
+      if (failed) {
+        stats.failed_literals++;
+        add_proof_unit(~lit);
+        enqueue(~lit);
+        if (propagate()) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+  // Propagate top-level assignments and remove them from the occurrences.
+  // Returns false on a conflict.
+  bool propagate_units() {
+    while (true) {
+      if (propagate()) {
+        return false;
+      }
+      if (occ_head == trail.size()) {
+        return true;
+      }
+      const Lit lit = trail[occ_head++];
+      // An assigned variable never occurs again.
+      const std::vector<CRef> list = std::move(occs[lit.vidx()]);
+      occs[lit.vidx()].clear();
+      for (const CRef cr : list) {
+        if (ca[cr].deleted()) {
+          continue;
+        }
+        ArenaClause clause = ca[cr];
+        if (std::find(clause.begin(), clause.end(), lit) != clause.end()) {
+          remove_irredundant(cr);
+        } else if (!strengthen(cr, ~lit)) {
+          return false;
+        }
+      }
+    }
+  }
+  // Occurrence lists drop deleted clauses lazily.
+  std::vector<CRef> &occurrences(Var v) {
+    std::vector<CRef> &list = occs[static_cast<size_t>(v)];
+    list.erase(std::remove_if(list.begin(), list.end(),
+                              [&](CRef cr) { return ca[cr].deleted(); }),
+               list.end());
+    return list;
+  }
+  void remove_irredundant(CRef cr) {
+    for (const Lit lit : ca[cr]) {
+      touched[lit.vidx()] = true;
+    }
+    remove_clause(cr);
+  }
+  // Remove `lit` from an irredundant clause. A unit clause is enqueued and
+  // has to be propagated by propagate_units(). Returns false on a conflict.
+  bool strengthen(CRef cr, Lit lit) {
+    unwatch_clause(cr);
+    ArenaClause clause = ca[cr];
+    if (logging_proof()) {
+      proof_buf.clear();
+      std::copy_if(clause.begin(), clause.end(), std::back_inserter(proof_buf),
+                   [&](Lit other) { return other != lit; });
+      proof->add(proof_buf.begin(), proof_buf.end());
+      add_proof_units();
+      proof->remove(clause.begin(), clause.end());
+    }
+    [[maybe_unused]] Lit *const end =
+        std::remove(clause.begin(), clause.end(), lit);
+    assert(end + 1 == clause.end());
+    ca.shrink(cr, clause.size() - 1);
+    std::vector<CRef> &list = occs[lit.vidx()];
+    list.erase(std::remove(list.begin(), list.end(), cr), list.end());
+    touched[lit.vidx()] = true;
+    stats.strengthened++;
+    if (clause.size() > 1) {
+      watch_clause(cr);
+      subsume_queue.push_back(cr);
+      return true;
+    }
+    const Lit unit = clause[0];
+    ca.free(cr);
+    if (eval(unit) == LitBool::Undefine) {
+      enqueue(unit);
+    }
+    return eval(unit) == LitBool::True;
+  }
+  // Remove clauses subsumed by the queued ones and strengthen clauses by
+  // self-subsuming resolution: (a v b) and (~a v b v c) => (b v c)
+  bool subsume() {
+    for (size_t i = 0; i < subsume_queue.size(); i++) {
+      if (steps > options.preprocess_limit) {
+        break;
+      }
+      const CRef cr = subsume_queue[i];
+      if (!ca[cr].deleted() && !backward_subsume(cr)) {
+        return false;
+      }
+    }
+    subsume_queue.clear();
+    return true;
+  }
+  bool backward_subsume(CRef cr) {
+    ArenaClause clause = ca[cr];
+    // Every candidate contains the least occurring variable.
+    Var best = clause[0].var();
+    lit_stamp++;
+    for (const Lit lit : clause) {
+      lit_stamps[lit.lidx()] = lit_stamp;
+      if (occs[lit.vidx()].size() < occs[static_cast<size_t>(best)].size()) {
+        best = lit.var();
+      }
+    }
+    const size_t size = clause.size();
+    // strengthen() edits the list.
+    const std::vector<CRef> candidates = occurrences(best);
+    for (const CRef other : candidates) {
+      ArenaClause candidate = ca[other];
+      if (other == cr || candidate.deleted() || candidate.size() < size) {
+        continue;
+      }
+      steps += candidate.size();
+      size_t found = 0, flipped = 0;
+      Lit flipped_lit = candidate[0];
+      for (const Lit lit : candidate) {
+        if (lit_stamps[lit.lidx()] == lit_stamp) {
+          found++;
+        } else if (lit_stamps[(~lit).lidx()] == lit_stamp) {
+          flipped++;
+          flipped_lit = lit;
+        }
+      }
+      if (found == size) {
+        stats.subsumed++;
+        remove_irredundant(other);
+      } else if (flipped == 1 && found + 1 == size) {
+        if (!strengthen(other, flipped_lit)) {
+          return false;
+        }
+        if (trail.size() > occ_head) {
+          // A unit may change the clause itself.
+          if (!propagate_units()) {
+            return false;
+          }
+          if (!ca[cr].deleted()) {
+            subsume_queue.push_back(cr);
+          }
+          return true;
+        }
+      }
+    }
+    return true;
+  }
+  // Bounded variable elimination: replace the clauses of a variable with
+  // their resolvents if it doesn't increase the number of clauses.
+  bool eliminate() {
+    std::vector<Var> candidates;
+    while (steps <= options.preprocess_limit) {
+      candidates.clear();
+      for (size_t v = 0; v < num_vars(); v++) {
+        if (touched[v] && !eliminated[v] &&
+            eval(Lit(Var(v), true)) == LitBool::Undefine) {
+          candidates.push_back(Var(v));
+        }
+        touched[v] = false;
+      }
+      if (candidates.empty()) {
+        break;
+      }
+      // Cheap variables first
+      std::stable_sort(candidates.begin(), candidates.end(),
+                       [&](Var left, Var right) {
+                         return occs[static_cast<size_t>(left)].size() <
+                                occs[static_cast<size_t>(right)].size();
+                       });
+      for (const Var v : candidates) {
+        if (steps > options.preprocess_limit) {
+          break;
+        }
+        if (!eliminate_var(v) || !subsume()) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+  bool eliminate_var(Var v) {
+    if (eliminated[static_cast<size_t>(v)] || frozen[static_cast<size_t>(v)] ||
+        eval(Lit(v, true)) != LitBool::Undefine) {
+      return true;
+    }
+    std::vector<CRef> pos, neg;
+    for (const CRef cr : occurrences(v)) {
+      ArenaClause clause = ca[cr];
+      const bool positive =
+          std::find(clause.begin(), clause.end(), Lit(v, true)) !=
+          clause.end();
+      (positive ? pos : neg).push_back(cr);
+    }
+    const size_t limit = pos.size() + neg.size() + options.elim_grow;
+    resolvents.clear();
+    Clause resolvent;
+    for (const CRef p : pos) {
+      for (const CRef n : neg) {
+        steps += ca[p].size() + ca[n].size();
+        if (!resolve(p, n, v, resolvent)) {
+          continue;
+        }
+        if (resolvents.size() >= limit ||
+            resolvent.size() > options.elim_clause_limit) {
+          return true;
+        }
+        resolvents.push_back(resolvent);
+      }
+    }
+
+    eliminated[static_cast<size_t>(v)] = true;
+    stats.eliminated++;
+    if (logging_proof()) {
+      for (const Clause &clause : resolvents) {
+        proof->add(clause.begin(), clause.end());
+      }
+    }
+    for (auto *list : {&pos, &neg}) {
+      for (const CRef cr : *list) {
+        // The literal of `v` goes first for extend_model().
+        ArenaClause clause = ca[cr];
+        const Lit lit = Lit(v, list == &pos);
+        elim_lits.push_back(lit);
+        for (const Lit other : clause) {
+          if (other != lit) {
+            elim_lits.push_back(other);
+          }
+        }
+        elim_sizes.push_back(clause.size());
+        remove_irredundant(cr);
+      }
+    }
+    occs[static_cast<size_t>(v)] = {};
+    for (const Clause &clause : resolvents) {
+      if (clause.size() == 1) {
+        if (eval(clause[0]) == LitBool::False) {
+          return false;
+        }
+        if (eval(clause[0]) == LitBool::Undefine) {
+          enqueue(clause[0]);
+        }
+        continue;
+      }
+      const CRef cr = ca.alloc(clause, false);
+      attach_clause(cr);
+      for (const Lit lit : clause) {
+        occs[lit.vidx()].push_back(cr);
+        touched[lit.vidx()] = true;
+      }
+      subsume_queue.push_back(cr);
+    }
+    return propagate_units();
+  }
+  // Resolve two clauses on `v`. Returns false if the resolvent is a
+  // tautology.
+  bool resolve(CRef pos, CRef neg, Var v, Clause &resolvent) {
+    resolvent.clear();
+    lit_stamp++;
+    for (const Lit lit : ca[pos]) {
+      if (lit.var() != v) {
+        lit_stamps[lit.lidx()] = lit_stamp;
+        resolvent.push_back(lit);
+      }
+    }
+    for (const Lit lit : ca[neg]) {
+      if (lit.var() == v || lit_stamps[lit.lidx()] == lit_stamp) {
+        continue;
+      }
+      if (lit_stamps[(~lit).lidx()] == lit_stamp) {
+        return false;
+      }
+      resolvent.push_back(lit);
+    }
+    return true;
+  }
+  // Assign eliminated variables in the model so that the clauses removed by
+  // elimination are satisfied, latest first.
+  void extend_model() {
+    size_t end = elim_lits.size();
+    for (size_t i = elim_sizes.size(); i-- > 0;) {
+      const size_t begin = end - elim_sizes[i];
+      bool satisfied = false;
+      for (size_t j = begin; j < end && !satisfied; j++) {
+        satisfied = assings[elim_lits[j].vidx()] != elim_lits[j].neg();
+      }
+      if (!satisfied) {
+        assings[elim_lits[begin].vidx()] = elim_lits[begin].pos();
+      }
+      end = begin;
+    }
+  }
+  // Bring an eliminated variable back with the clauses removed by its
+  // elimination. They can contain variables eliminated later, which are
+  // restored too. Restored variables are frozen.
+  void restore_var(Var v) {
+    assert(decision_level() == 0);
+    std::vector<bool> restoring(num_vars(), false);
+    restoring[static_cast<size_t>(v)] = true;
+    for (bool changed = true; changed;) {
+      changed = false;
+      size_t begin = 0;
+      for (const size_t size : elim_sizes) {
+        if (restoring[elim_lits[begin].vidx()]) {
+          for (size_t j = begin; j < begin + size; j++) {
+            const size_t x = elim_lits[j].vidx();
+            if (eliminated[x] && !restoring[x]) {
+              restoring[x] = changed = true;
+            }
+          }
+        }
+        begin += size;
+      }
+    }
+    for (size_t x = 0; x < num_vars(); x++) {
+      if (restoring[x]) {
+        eliminated[x] = false;
+        frozen[x] = true;
+        branching.on_unassign(Var(x));
+      }
+    }
+    // Keep the other eliminated variables in the reconstruction stack.
+    std::vector<Clause> restored;
+    size_t begin = 0, lits_len = 0, sizes_len = 0;
+    for (const size_t size : elim_sizes) {
+      if (restoring[elim_lits[begin].vidx()]) {
+        restored.emplace_back(elim_lits.begin() + static_cast<long>(begin),
+                              elim_lits.begin() +
+                                  static_cast<long>(begin + size));
+      } else {
+        std::copy(elim_lits.begin() + static_cast<long>(begin),
+                  elim_lits.begin() + static_cast<long>(begin + size),
+                  elim_lits.begin() + static_cast<long>(lits_len));
+        lits_len += size;
+        elim_sizes[sizes_len++] = size;
+      }
+      begin += size;
+    }
+    elim_lits.resize(lits_len);
+    elim_sizes.resize(sizes_len);
+    for (const Clause &clause : restored) {
+      insert_clause(clause);
+    }
+  }
+  // Drop removed clauses from `clauses` and learnts.
+  void purge_deleted() {
+    for (auto *cls :
+         {&clauses, &learnts_core, &learnts_tier2, &learnts_local}) {
+      cls->erase(std::remove_if(cls->begin(), cls->end(),
+                                [&](CRef cr) { return ca[cr].deleted(); }),
+                 cls->end());
+    }
+  }
+
+  // Inprocessing
+
+  // Local search on the irredundant clauses under the top-level
+  // assignments, from the saved phases. Its best assignment becomes the
+  // saved phases. Returns true with a model in `assings` if it satisfies
+  // every clause.
+  bool walk(uint64_t max_flips) {
+    assert(decision_level() == 0);
+    stats.walks++;
+    next_walk = stats.conflicts + options.walk_interval * stats.walks;
+    walker.reset(num_vars());
+    for (const CRef cr : clauses) {
+      ArenaClause clause = ca[cr];
+      if (clause.deleted()) {
+        continue;
+      }
+      walk_buf.clear();
+      bool satisfied = false;
+      for (const Lit lit : clause) {
+        const LitBool value = eval(lit);
+        satisfied |= value == LitBool::True;
+        if (value == LitBool::Undefine) {
+          walk_buf.push_back(lit);
+        }
+      }
+      if (satisfied) {
+        continue;
+      }
+      if (walk_buf.empty()) {
+        // a conflict for propagate() to find
+        return false;
+      }
+      walker.add_clause(walk_buf.begin(), walk_buf.end());
+    }
+    const bool found = walker.run(phases.saved_phases(), max_flips);
+    stats.walk_flips += walker.flips;
+    walk_propagations = stats.propagations;
+    phases.import_saved(walker.best());
+    if (!found) {
+      return false;
+    }
+    assings.resize(num_vars());
+    for (size_t i = 0; i < num_vars(); i++) {
+      const LitBool value = eval(Lit(Var(i), true));
+      assings[i] = value == LitBool::Undefine ? walker.best()[i]
+                                              : value == LitBool::True;
+    }
+    extend_model();
+    return true;
+  }
+  // flips of the next round
+  [[nodiscard]] uint64_t walk_budget() const {
+    if (stats.walks == 0) {
+      return options.walk_flips;
+    }
+    return static_cast<uint64_t>(
+        static_cast<double>(stats.propagations - walk_propagations) *
+        options.walk_effort);
+  }
+
+  // Simplify learnt clauses at the top level between restarts.
+  // Returns false if the formula is unsatisfiable.
+  bool inprocess() {
+    assert(decision_level() == 0);
+    stats.inprocessings++;
+    const uint64_t search_propagations =
+        stats.propagations - inprocess_propagations;
+    const uint64_t budget = std::max(
+        INPROCESS_MIN_EFFORT,
+        static_cast<uint64_t>(static_cast<double>(search_propagations) *
+                              options.inprocess_effort));
+    next_inprocess =
+        stats.conflicts + options.inprocess_interval * stats.inprocessings;
+
+    if (!skip_simplify) {
+      simplify();
+      skip_simplify = true;
+    }
+    remove_duplicate_binaries();
+    bool ok = !propagate();
+    if (ok) {
+      subsume_learnts(budget);
+      ok = vivify_learnts(budget);
+    }
+    purge_deleted();
+    check_garbage();
+    inprocess_propagations = stats.propagations;
+    return ok;
+  }
+  // Remove a binary clause that appears twice and find a unit from
+  // (~lit v a) and (~lit v ~a).
+  void remove_duplicate_binaries() {
+    for (size_t i = 0; i < 2 * num_vars(); i++) {
+      const Lit lit = Lit(Var(i / 2), i % 2 == 0);
+      if (eval(lit) != LitBool::Undefine) {
+        continue;
+      }
+      lit_stamp++;
+      // Keep an irredundant copy.
+      const std::vector<Watcher> list = bin_watchers[i];
+      for (const bool learnt : {false, true}) {
+        for (const Watcher &w : list) {
+          if (ca[w.cref].learnt() != learnt || ca[w.cref].deleted()) {
+            continue;
+          }
+          if (lit_stamps[w.blocker.lidx()] == lit_stamp) {
+            stats.duplicate_binaries++;
+            remove_clause(w.cref);
+            continue;
+          }
+          lit_stamps[w.blocker.lidx()] = lit_stamp;
+          if (lit_stamps[(~w.blocker).lidx()] == lit_stamp &&
+              eval(lit) == LitBool::Undefine) {
+            add_proof_unit(~lit);
+            enqueue(~lit);
+            skip_simplify = false;
+          }
+        }
+      }
+    }
+  }
+  // Remove a learnt clause subsumed by a smaller one.
+  // A candidate is watched by its least watched literal only.
+  void subsume_learnts(uint64_t budget) {
+    std::vector<CRef> candidates;
+    for (auto *learnts : {&learnts_core, &learnts_tier2, &learnts_local}) {
+      for (const CRef cr : *learnts) {
+        if (!ca[cr].deleted() && ca[cr].size() <= SUBSUME_CLAUSE_LIMIT) {
+          candidates.push_back(cr);
+        }
+      }
+    }
+    std::stable_sort(candidates.begin(), candidates.end(),
+                     [&](CRef left, CRef right) {
+                       return ca[left].size() < ca[right].size();
+                     });
+    std::vector<std::vector<CRef>> lit_occs(2 * num_vars());
+    uint64_t visited = 0;
+    for (const CRef cr : candidates) {
+      if (visited > budget) {
+        break;
+      }
+      ArenaClause clause = ca[cr];
+      lit_stamp++;
+      for (const Lit lit : clause) {
+        lit_stamps[lit.lidx()] = lit_stamp;
+      }
+      std::optional<CRef> subsuming;
+      for (const Lit lit : clause) {
+        for (const CRef other : lit_occs[lit.lidx()]) {
+          ArenaClause smaller = ca[other];
+          visited += smaller.size();
+          if (std::all_of(smaller.begin(), smaller.end(), [&](Lit l) {
+                return lit_stamps[l.lidx()] == lit_stamp;
+              })) {
+            subsuming = other;
+            break;
+          }
+        }
+        if (subsuming) {
+          break;
+        }
+      }
+      if (subsuming) {
+        // The survivor inherits the better LBD.
+        ArenaClause smaller = ca[subsuming.value()];
+        if (clause.lbd() < smaller.lbd()) {
+          smaller.set_lbd(clause.lbd());
+          if (tier_of(clause.lbd()) < smaller.tier()) {
+            smaller.set_tier(tier_of(clause.lbd()));
+          }
+        }
+        stats.subsumed++;
+        remove_clause(cr);
+        continue;
+      }
+      Lit watch = clause[0];
+      for (const Lit lit : clause) {
+        if (lit_occs[lit.lidx()].size() < lit_occs[watch.lidx()].size()) {
+          watch = lit;
+        }
+      }
+      lit_occs[watch.lidx()].push_back(cr);
+    }
+    // reduce_learnts() moves clauses promoted here.
+  }
+  // Shorten learnt clauses by propagating the negation of their literals.
+  // Returns false if the formula is unsatisfiable.
+  bool vivify_learnts(uint64_t budget) {
+    std::vector<CRef> candidates;
+    for (auto *learnts : {&learnts_core, &learnts_tier2}) {
+      for (const CRef cr : *learnts) {
+        if (!ca[cr].deleted() && !ca[cr].vivified() && ca[cr].size() > 2) {
+          candidates.push_back(cr);
+        }
+      }
+    }
+    std::stable_sort(candidates.begin(), candidates.end(),
+                     [&](CRef left, CRef right) {
+                       return ca[left].lbd() < ca[right].lbd();
+                     });
+    const uint64_t limit = stats.propagations + budget;
+    for (const CRef cr : candidates) {
+      if (stats.propagations > limit) {
+        break;
+      }
+      if (!vivify_clause(cr)) {
+        return false;
+      }
+    }
+    return true;
+  }
+  bool vivify_clause(CRef cr) {
+    ArenaClause clause = ca[cr];
+    clause.mark_vivified();
+    for (const Lit lit : clause) {
+      if (eval(lit) == LitBool::True) {
+        // satisfied at the top level
+        return true;
+      }
+    }
+    // The clause must not propagate itself.
+    unwatch_clause(cr);
+    Clause &kept = vivify_clause_buf;
+    kept.clear();
+    bool shortened = false;
+    for (const Lit lit : clause) {
+      const LitBool value = eval(lit);
+      if (value == LitBool::False) {
+        // implied by the negation of the literals before
+        shortened = true;
+        continue;
+      }
+      kept.push_back(lit);
+      if (value == LitBool::True) {
+        shortened = true;
+        break;
+      }
+      new_decision(~lit);
+      if (propagate()) {
+        shortened = kept.size() < clause.size();
+        break;
+      }
+    }
+    pop_queue_until(0, false);
+    if (!shortened) {
+      watch_clause(cr);
+      return true;
+    }
+    stats.vivified++;
+    const uint32_t lbd =
+        std::min(clause.lbd(), static_cast<uint32_t>(kept.size()));
+    // `clause` is invalid after add_learnt_clause() grows the arena.
+    const float activity = clause.activity();
+    const bool used = clause.used();
+    stats.learnts_deleted++;
+    if (logging_proof()) {
+      proof->add(kept.begin(), kept.end());
+      add_proof_units();
+      proof->remove(clause.begin(), clause.end());
+    }
+    ca.free(cr);
+    if (kept.empty()) {
+      return false;
+    }
+    if (kept.size() == 1) {
+      enqueue(kept[0]);
+      skip_simplify = false;
+      return !propagate();
+    }
+    const CRef vivified = add_learnt_clause(kept, lbd);
+    ca[vivified].mark_vivified();
+    ca[vivified].set_activity(activity);
+    ca[vivified].set_used(used);
+    return true;
+  }
+
+  // Write a DRAT proof of Unsat to `writer`. Imported clauses aren't in the
+  // proof, so it doesn't go with share_clauses().
+  void write_proof(ProofWriter &writer) {
+    static_assert(Config::proof, "proofs are disabled by Config::proof");
+    assert(exchange == nullptr);
+    proof = &writer;
+  }
+  [[nodiscard]] bool logging_proof() const {
+    if constexpr (Config::proof) {
+      return proof != nullptr;
+    } else {
+      return false;
+    }
+  }
+  void add_proof_unit(Lit lit) {
+    if (logging_proof()) {
+      proof->add(&lit, &lit + 1);
+    }
+  }
+  // Top-level assignments go to the proof before a clause implying one is
+  // deleted, otherwise a checker can't derive them.
+  void add_proof_units() {
+    if (!logging_proof()) {
+      return;
+    }
+    const size_t end = trail_lim.empty() ? trail.size() : trail_lim[0];
+    for (; proof_units < end; proof_units++) {
+      add_proof_unit(trail[proof_units]);
+    }
+  }
+  // Remember the refutation. Unsat under assumptions goes elsewhere.
+  Status refuted() {
+    status = Status::Unsat;
+    if (logging_proof()) {
+      const Lit *none = nullptr;
+      proof->add(none, none);
+      proof->flush();
+    }
+    return Status::Unsat;
+  }
+
+  // Export learnt clauses to `exchange` as worker `id` and import the
+  // others' at restarts.
+  void share_clauses(ClauseExchange &clause_exchange, size_t id) {
+    assert(proof == nullptr);
+    exchange = &clause_exchange;
+    exchange_id = id;
+  }
+  void export_clause(const Clause &clause, uint32_t lbd) {
+    if (exchange != nullptr && lbd <= options.share_lbd &&
+        clause.size() <= ClauseExchange::MAX_SIZE) {
+      exchange->publish(exchange_id, clause, lbd);
+      stats.exported++;
+    }
+  }
+  // Returns false if an imported clause is falsified at the top level.
+  bool import_clauses() {
+    assert(decision_level() == 0);
+    bool ok = true;
+    exchange->collect(
+        exchange_id, exchange_cursors, import_buf,
+        [&](Clause &clause, uint32_t lbd) {
+          size_t new_size = 0;
+          for (const Lit lit : clause) {
+            // Another worker may have kept a variable eliminated here.
+            if (eliminated[lit.vidx()] || eval(lit) == LitBool::True) {
+              return;
+            }
+            if (eval(lit) == LitBool::Undefine) {
+              clause[new_size++] = lit;
+            }
+          }
+          clause.resize(new_size);
+          stats.imported++;
+          if (clause.empty()) {
+            ok = false;
+          } else if (clause.size() == 1) {
+            enqueue(clause[0]);
+            skip_simplify = false;
+          } else {
+            add_learnt_clause(
+                clause, std::min(lbd, static_cast<uint32_t>(clause.size())));
+          }
+        });
+    return ok;
+  }
+  // Whether solve() can go on within the budget. Progress is reported on
+  // the way.
+  [[nodiscard]] bool within_budget() {
+    if (stats.conflicts >= conflict_limit ||
+        stats.propagations >= propagation_limit ||
+        stats.decisions >= decision_limit) {
+      return false;
+    }
+    // The clock is read at the first check of a call.
+    if ((!deadline && !progress) || budget_checks++ % CLOCK_INTERVAL != 0) {
+      return true;
+    }
+    const auto now = std::chrono::steady_clock::now();
+    if (progress && now >= next_progress) {
+      next_progress = now + progress_interval;
+      progress(stats);
+    }
+    return !deadline || now < deadline.value();
+  }
+  // Call `report` with the statistics every `seconds` during solve().
+  void set_progress(double seconds,
+                    std::function<void(const Stats &)> report) {
+    progress_interval =
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(seconds));
+    next_progress = std::chrono::steady_clock::now() + progress_interval;
+    progress = std::move(report);
+  }
+  // Stop solve() from another thread.
+  void interrupt() { interrupted.store(true, std::memory_order_relaxed); }
+  // solve() returns Unknown once it spends `budget` from now on. Later calls
+  // share what is left until the budget is set again, so the search can be
+  // continued in slices.
+  void set_budget(const Budget &budget) {
+    auto limit = [](std::optional<uint64_t> amount, uint64_t used) {
+      return amount ? used + amount.value() : NO_LIMIT;
+    };
+    conflict_limit = limit(budget.conflicts, stats.conflicts);
+    propagation_limit = limit(budget.propagations, stats.propagations);
+    decision_limit = limit(budget.decisions, stats.decisions);
+    memory_limit = budget.memory_bytes.value_or(NO_LIMIT);
+    next_memory_check = 0;
+    deadline = std::nullopt;
+    if (budget.seconds) {
+      using Clock = std::chrono::steady_clock;
+      deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(
+                                    std::chrono::duration<double>(
+                                        budget.seconds.value()));
+    }
+  }
+
+  // Keep a variable through preprocessing (e.g. to assume it later).
+  // Assumed variables are frozen by solve() anyway, but freezing them
+  // up front saves restoring them after elimination.
+  void freeze(Var v) {
+    new_vars(static_cast<size_t>(v) + 1);
+    frozen[static_cast<size_t>(v)] = true;
+  }
+  [[nodiscard]] size_t num_assigned() const { return trail.size(); }
+
+  Status solve() { return solve(std::vector<Lit>()); }
+  // Solve with `assumptions` decided first. Unsat under assumptions isn't
+  // remembered, so the solver can be called again with other assumptions
+  // and keeps its learnt clauses. On Unsat, `failed_assumptions` has the
+  // assumptions that made it.
+  Status solve(const std::vector<Lit> &assumptions) {
+    const Status result = search(assumptions);
+    stats.memory_bytes = memory_usage();
+    return result;
+  }
+  // Bytes held by clauses, watchers, the trail, the variable order and the
+  // other per-variable and per-clause data of the solver.
+  [[nodiscard]] size_t memory_usage() const {
+    return ca.memory_bytes() + vector_bytes(clauses) +
+           vector_bytes(learnts_core) + vector_bytes(learnts_tier2) +
+           vector_bytes(learnts_local) + vector_bytes(watchers) +
+           vector_bytes(bin_watchers) + vector_bytes(values) +
+           vector_bytes(reasons) + vector_bytes(levels) + vector_bytes(seen) +
+           vector_bytes(trail) + vector_bytes(trail_lim) +
+           branching.memory_bytes() + vector_bytes(level_stamps) +
+           vector_bytes(lit_stamps) + vector_bytes(occs) +
+           vector_bytes(elim_lits) + vector_bytes(elim_sizes) +
+           walker.memory_bytes() + vector_bytes(input_lits) +
+           vector_bytes(input_sizes);
+  }
+
+private:
+  Status search(const std::vector<Lit> &assumptions) {
+    failed_assumptions.clear();
+    if (status == Status::Unsat) {
+      return Status::Unsat;
+    }
+    pop_queue_until(0);
+    for (const Lit lit : assumptions) {
+      freeze(lit.var());
+      if (eliminated[lit.vidx()]) {
+        restore_var(lit.var());
+      }
+    }
+    if (status == Status::Unsat) {
+      return Status::Unsat;
+    }
+    if (options.preprocess && !preprocessed && !preprocess()) {
+      return refuted();
+    }
+    if (options.walk && assumptions.empty() && stats.walks == 0 &&
+        !interrupted.load(std::memory_order_relaxed) && walk(walk_budget())) {
+      return Status::Sat;
+    }
+    budget_checks = 0;
+    double max_limit_learnts =
+        static_cast<double>(clauses.size()) * Config::learnt_limit;
+    while (true) {
+      if (!within_budget()) {
+        pop_queue_until(0);
+        return Status::Unknown;
+      }
+      if (std::optional<CRef> conflict = propagate()) {
+        // Conflict
+        stats.conflicts++;
+        if (options.chrono) {
+          const CRef cr = conflict.value();
+          const int level = conflict_level(cr);
+          if (level == 0) {
+            return refuted();
+          }
+          const int second = levels[ca[cr][1].vidx()];
+          if (second < level) {
+            // A missed implication of the only literal at `level`
+            pop_queue_until(level - 1);
+            enqueue_at(ca[cr][0], cr, second);
+            continue;
+          }
+          pop_queue_until(level);
+        }
+        if (decision_level() == 0) {
+          return refuted();
+        }
+        auto [learnt_clause, back_jump_level, lbd] = analyze(conflict.value());
+        stats.lbd_sum += lbd;
+        restart.on_conflict(lbd, trail.size());
+        phases.update(trail, trail_lim.back());
+        if (options.chrono && learnt_clause.size() > 1 &&
+            decision_level() - back_jump_level >
+                static_cast<int>(options.chrono_levels)) {
+          // Keep the levels in between. The learnt clause is still asserting
+          // at back_jump_level.
+          stats.chrono_backtracks++;
+          pop_queue_until(decision_level() - 1);
+        } else {
+          pop_queue_until(back_jump_level);
+        }
+        export_clause(learnt_clause, lbd);
+        if (logging_proof()) {
+          proof->add(learnt_clause.begin(), learnt_clause.end());
+        }
+        if (learnt_clause.size() == 1) {
+          enqueue(learnt_clause[0]);
+          // a unit clause can simplify clauses
+          // (!x1)
+          // Delete: (!x1 v x2 v x3)
+          skip_simplify = false;
+        } else {
+          CRef cr = add_learnt_clause(learnt_clause, lbd);
+          enqueue_at(learnt_clause[0], cr, back_jump_level);
+        }
+
+        branching.on_conflict(stats.conflicts);
+        cla_bump_inc *= (1.0 / options.clause_decay);
+        if (phases.should_rephase(stats.conflicts)) {
+          phases.rephase(stats.conflicts);
+          stats.rephases++;
+        }
+      } else {
+        // No Conflict
+        if (restart.should_restart()) {
+          pop_queue_until(0);
+          restart.on_restart();
+          stats.restarts++;
+          if (options.inprocess && stats.conflicts >= next_inprocess &&
+              !inprocess()) {
+            return refuted();
+          }
+          if (options.walk && assumptions.empty() &&
+              stats.conflicts >= next_walk && walk(walk_budget())) {
+            return Status::Sat;
+          }
+          if (exchange != nullptr) {
+            if (!import_clauses()) {
+              return refuted();
+            }
+            if (que_head < trail.size()) {
+              // Propagate imported units at the top level.
+              continue;
+            }
+          }
+        }
+        if (interrupted.load(std::memory_order_relaxed)) {
+          interrupted.store(false, std::memory_order_relaxed);
+          pop_queue_until(0);
+          return Status::Unknown;
+        }
+
+        if (!skip_simplify && decision_level() == 0) {
+          // simplify clauses at the top level.
+          simplify();
+          skip_simplify = true;
+        }
+
+        if (memory_limit != NO_LIMIT && stats.conflicts >= next_memory_check) {
+          next_memory_check = stats.conflicts + MEMORY_CHECK_INTERVAL;
+          if (!fit_memory(max_limit_learnts)) {
+            pop_queue_until(0);
+            return Status::Unknown;
+          }
+        }
+        if (Config::reduce &&
+            learnts_local.size() >= static_cast<size_t>(max_limit_learnts)) {
+          // Reduce the set of learnt clauses
+          max_limit_learnts *= Config::learnt_growth;
+          reduce_learnts();
+        }
+        std::optional<Lit> assumption;
+        while (static_cast<size_t>(decision_level()) < assumptions.size()) {
+          const Lit lit = assumptions[static_cast<size_t>(decision_level())];
+          if (eval(lit) == LitBool::True) {
+            // an empty level to keep levels aligned with assumptions
+            trail_lim.push_back(trail.size());
+          } else if (eval(lit) == LitBool::False) {
+            // Unsat under the assumptions
+            analyze_final(lit);
+            pop_queue_until(0);
+            return Status::Unsat;
+          } else {
+            assumption = lit;
+            break;
+          }
+        }
+        if (assumption) {
+          new_decision(assumption.value());
+          continue;
+        }
+        std::optional<Var> v = branching.pick([&](Var x) {
+          return eval(Lit(x, true)) != LitBool::Undefine ||
+                 eliminated[static_cast<size_t>(x)];
+        });
+        if (!v) {
+          // All variables are assigned.
+          assings.resize(num_vars());
+          for (size_t i = 0; i < num_vars(); i++) {
+            assings[i] = eval(Lit(Var(i), true)) == LitBool::True;
+          }
+          extend_model();
+          return Status::Sat;
+        }
+        Lit next = phases.decide(v.value(), branching.is_stable());
+        stats.decisions++;
+        new_decision(next);
+      }
+    }
+  }
+  // All variables
+public:
+  // a model after solve() returns Sat
+  std::vector<bool> assings;
+  // Unsat once the formula is refuted without assumptions
+  std::optional<Status> status;
+  // a subset of the assumptions that is Unsat after solve() returns Unsat,
+  // empty if the formula is Unsat without them
+  std::vector<Lit> failed_assumptions;
+  Stats stats;
+
+private:
+  // compact the arena when more than this fraction of it is wasted
+  static constexpr double GARBAGE_FRAC = 0.2;
+  // Longer learnt clauses are hardly subsumed.
+  static constexpr size_t SUBSUME_CLAUSE_LIMIT = 64;
+  // the least budget of an inprocessing round
+  static constexpr uint64_t INPROCESS_MIN_EFFORT = 10000;
+  static constexpr uint64_t NO_LIMIT = std::numeric_limits<uint64_t>::max();
+  // reading the clock every decision is too slow
+  static constexpr uint64_t CLOCK_INTERVAL = 256;
+  // Measuring memory visits every watch list, so it is done every this many
+  // conflicts. Above MEMORY_PRESSURE of the limit, learnt clauses are
+  // reduced up to MEMORY_REDUCE_ROUNDS times.
+  static constexpr uint64_t MEMORY_CHECK_INTERVAL = 1000;
+  static constexpr double MEMORY_PRESSURE = 0.9;
+  static constexpr int MEMORY_REDUCE_ROUNDS = 4;
+  // Literals of more variables don't fit in Lit.
+  static constexpr uint32_t MAX_SNAPSHOT_VARS =
+      std::numeric_limits<int>::max() / 2;
+  // the least number of local learnt clauses kept under memory pressure
+  static constexpr double MIN_LEARNT_LIMIT = 100;
+  // Rebuild the heap when unassigning more than 1/HEAP_REBUILD_RATIO of
+  // the variables at once.
+  static constexpr size_t HEAP_REBUILD_RATIO = 2;
+
+  ClauseArena ca;
+  std::vector<CRef> clauses;
+  std::vector<CRef> learnts_core, learnts_tier2, learnts_local;
+  // watchers[lit] has clauses that contain ~lit.
+  std::vector<std::vector<Watcher>> watchers, bin_watchers;
+  // literal index, followed by VALUE_PADDING undefined values
+  std::vector<LitBool> values =
+      std::vector<LitBool>(VALUE_PADDING, LitBool::Undefine);
+  // variable index
+  std::vector<CRef> reasons;
+  std::vector<int> levels;
+  std::vector<bool> seen;
+  bool skip_simplify = false;
+
+  // assigned literals in chronological order
+  std::vector<Lit> trail;
+  // trail_lim[i] is the start of a decision level i + 1 in the trail
+  std::vector<size_t> trail_lim;
+  size_t que_head = 0;
+  double cla_bump_inc = 1.0;
+
+  SolverOptions options;
+  BasicRestartScheduler<Config> restart;
+  BasicBranching<Config> branching;
+  Phases phases;
+  // a scratch for compute_lbd()
+  std::vector<uint64_t> level_stamps;
+  uint64_t lbd_stamp = 0;
+  // scratches for minimizing a learnt clause
+  std::vector<Lit> analyze_stack, analyze_toclear;
+  // the learnt clause of analyze() and the clause of insert_clause()
+  Clause learnt_buf, add_buf;
+  // variables to bump after analyze()
+  std::vector<Var> analyze_bumped;
+  // a scratch of literal marks
+  std::vector<uint64_t> lit_stamps;
+  uint64_t lit_stamp = 0;
+
+  // preprocessing
+  bool preprocessed = false;
+  // variable index
+  std::vector<bool> eliminated, frozen;
+  // irredundant clauses that contain a variable
+  std::vector<std::vector<CRef>> occs;
+  // variables whose occurrences changed
+  std::vector<bool> touched;
+  std::vector<CRef> subsume_queue;
+  std::vector<Clause> resolvents;
+  // trail[occ_head..] are not removed from occs yet.
+  size_t occ_head = 0;
+  // visited literals
+  uint64_t steps = 0;
+  // clauses removed by variable elimination, each is the literal of the
+  // eliminated variable followed by the rest
+  std::vector<Lit> elim_lits;
+  std::vector<size_t> elim_sizes;
+
+  // inprocessing
+  uint64_t next_inprocess = options.inprocess_interval;
+  // propagations at the end of the last round
+  uint64_t inprocess_propagations = 0;
+  Clause vivify_clause_buf;
+
+  // local search
+  LocalSearch walker;
+  uint64_t next_walk = 0;
+  // propagations at the end of the last round
+  uint64_t walk_propagations = 0;
+  Clause walk_buf;
+
+  // clause sharing
+  ClauseExchange *exchange = nullptr;
+  size_t exchange_id = 0;
+  std::vector<uint64_t> exchange_cursors;
+  Clause import_buf;
+  std::atomic<bool> interrupted{false};
+
+  // proof and model checking
+  ProofWriter *proof = nullptr;
+  Clause proof_buf;
+  // trail[..proof_units] are in the proof
+  size_t proof_units = 0;
+  // the input clauses one after another
+  std::vector<Lit> input_lits;
+  std::vector<size_t> input_sizes;
+
+  // budget
+  uint64_t conflict_limit = NO_LIMIT;
+  uint64_t propagation_limit = NO_LIMIT;
+  uint64_t decision_limit = NO_LIMIT;
+  uint64_t memory_limit = NO_LIMIT;
+  uint64_t next_memory_check = 0;
+  std::optional<std::chrono::steady_clock::time_point> deadline;
+  uint64_t budget_checks = 0;
+  std::function<void(const Stats &)> progress;
+  std::chrono::steady_clock::duration progress_interval{};
+  std::chrono::steady_clock::time_point next_progress;
+};
+using Solver = BasicSolver<DefaultConfig>;
+
+// A source of bytes for InputStream.
+class Source {
+public:
+  virtual ~Source() = default;
+  // Read at most `size` bytes into `buf`. Returns 0 at the end.
+  virtual size_t read(char *buf, size_t size) = 0;
+  // why read() stopped early
+  [[nodiscard]] virtual std::optional<std::string> error() const {
+    return std::nullopt;
+  }
+};
+
+class FdSource : public Source {
+public:
+  explicit FdSource(int file) : fd(file) {}
+  size_t read(char *buf, size_t size) override {
+    while (true) {
+      const ssize_t n = ::read(fd, buf, size);
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      return n < 0 ? 0 : static_cast<size_t>(n);
+    }
+  }
+
+private:
+  int fd;
+};
+
+class MemorySource : public Source {
+public:
+  MemorySource(const char *data, size_t size) : cur(data), end(data + size) {}
+  size_t read(char *buf, size_t size) override {
+    const size_t n = std::min(size, static_cast<size_t>(end - cur));
+    std::copy(cur, cur + n, buf);
+    cur += n;
+    return n;
+  }
+
+private:
+  const char *cur, *end;
+};
+
+// Bytes that were read ahead to detect a format, followed by the rest.
+class PrefixSource : public Source {
+public:
+  PrefixSource(std::vector<char> head, std::unique_ptr<Source> src)
+      : prefix(std::move(head)), upstream(std::move(src)) {}
+  size_t read(char *buf, size_t size) override {
+    if (pos < prefix.size()) {
+      const size_t n = std::min(size, prefix.size() - pos);
+      std::copy(prefix.begin() + static_cast<std::ptrdiff_t>(pos),
+                prefix.begin() + static_cast<std::ptrdiff_t>(pos + n), buf);
+      pos += n;
+      return n;
+    }
+    return upstream->read(buf, size);
+  }
+
+private:
+  std::vector<char> prefix;
+  size_t pos = 0;
+  std::unique_ptr<Source> upstream;
+};
+
+enum class Compression { None, Gzip, Xz };
+
+// by magic numbers
+inline Compression detect_compression(const char *data, size_t size) {
+  const auto *bytes = reinterpret_cast<const unsigned char *>(data);
+  if (size >= 2 && bytes[0] == 0x1f && bytes[1] == 0x8b) {
+    return Compression::Gzip;
+  }
+  static constexpr unsigned char xz_magic[] = {0xfd, '7', 'z', 'X', 'Z', 0x00};
+  if (size >= std::size(xz_magic) &&
+      std::equal(std::begin(xz_magic), std::end(xz_magic), bytes)) {
+    return Compression::Xz;
+  }
+  return Compression::None;
+}
+
+#ifdef BULLSAT_ZLIB
+// Inflate gzip(or zlib) data chunk by chunk.
+class GzipSource : public Source {
+public:
+  explicit GzipSource(std::unique_ptr<Source> src)
+      : upstream(std::move(src)), input(CHUNK_SIZE) {
+    stream.zalloc = Z_NULL;
+    stream.zfree = Z_NULL;
+    stream.opaque = Z_NULL;
+    stream.next_in = Z_NULL;
+    stream.avail_in = 0;
+    // 15: the maximum window, +32: detect a gzip or zlib header
+    if (inflateInit2(&stream, 15 + 32) != Z_OK) {
+      message = "cannot initialize zlib";
+      finished = true;
+    }
+  }
+  GzipSource(const GzipSource &) = delete;
+  GzipSource &operator=(const GzipSource &) = delete;
+  ~GzipSource() override { inflateEnd(&stream); }
+
+  size_t read(char *buf, size_t size) override {
+    if (finished) {
+      return 0;
+    }
+    size = std::min(size,
+                    static_cast<size_t>(std::numeric_limits<uInt>::max()));
+    stream.next_out = reinterpret_cast<Bytef *>(buf);
+    stream.avail_out = static_cast<uInt>(size);
+    while (stream.avail_out > 0) {
+      if (stream.avail_in == 0) {
+        const size_t n = upstream->read(input.data(), input.size());
+        if (n == 0) {
+          if (!member_end) {
+            message = "unexpected end of gzip data";
+          }
+          finished = true;
+          break;
+        }
+        stream.next_in = reinterpret_cast<Bytef *>(input.data());
+        stream.avail_in = static_cast<uInt>(n);
+      }
+      const int ret = inflate(&stream, Z_NO_FLUSH);
+      member_end = false;
+      if (ret == Z_STREAM_END) {
+        // A file may have concatenated members.
+        member_end = true;
+        inflateReset(&stream);
+      } else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+        message = "corrupt gzip data";
+        finished = true;
+        break;
+      }
+    }
+    return size - stream.avail_out;
+  }
+  [[nodiscard]] std::optional<std::string> error() const override {
+    return message;
+  }
+
+private:
+  static constexpr size_t CHUNK_SIZE = 1 << 18;
+  std::unique_ptr<Source> upstream;
+  std::vector<char> input;
+  z_stream stream;
+  bool member_end = false;
+  bool finished = false;
+  std::optional<std::string> message;
+};
+#endif
+
+#ifdef BULLSAT_LZMA
+// Decompress xz data chunk by chunk.
+class XzSource : public Source {
+public:
+  explicit XzSource(std::unique_ptr<Source> src)
+      : upstream(std::move(src)), input(CHUNK_SIZE) {
+    if (lzma_stream_decoder(&stream, std::numeric_limits<uint64_t>::max(),
+                            LZMA_CONCATENATED) != LZMA_OK) {
+      message = "cannot initialize liblzma";
+      finished = true;
+    }
+  }
+  XzSource(const XzSource &) = delete;
+  XzSource &operator=(const XzSource &) = delete;
+  ~XzSource() override { lzma_end(&stream); }
+
+  size_t read(char *buf, size_t size) override {
+    if (finished) {
+      return 0;
+    }
+    stream.next_out = reinterpret_cast<uint8_t *>(buf);
+    stream.avail_out = size;
+    while (stream.avail_out > 0) {
+      if (stream.avail_in == 0 && !input_end) {
+        const size_t n = upstream->read(input.data(), input.size());
+        if (n == 0) {
+          input_end = true;
+        } else {
+          stream.next_in = reinterpret_cast<const uint8_t *>(input.data());
+          stream.avail_in = n;
+        }
+      }
+      const lzma_ret ret =
+          lzma_code(&stream, input_end ? LZMA_FINISH : LZMA_RUN);
+      if (ret == LZMA_STREAM_END) {
+        finished = true;
+        break;
+      }
+      if (ret != LZMA_OK) {
+        message = ret == LZMA_BUF_ERROR ? "unexpected end of xz data"
+                                        : "corrupt xz data";
+        finished = true;
+        break;
+      }
+    }
+    return size - stream.avail_out;
+  }
+  [[nodiscard]] std::optional<std::string> error() const override {
+    return message;
+  }
+
+private:
+  static constexpr size_t CHUNK_SIZE = 1 << 18;
+  std::unique_ptr<Source> upstream;
+  std::vector<char> input;
+  lzma_stream stream = LZMA_STREAM_INIT;
+  bool input_end = false;
+  bool finished = false;
+  std::optional<std::string> message;
+};
+#endif
+
+class IstreamSource : public Source {
+public:
+  explicit IstreamSource(std::istream &input) : in(input) {}
+  size_t read(char *buf, size_t size) override {
+    in.read(buf, static_cast<std::streamsize>(size));
+    return static_cast<size_t>(in.gcount());
+  }
+
+private:
+  std::istream &in;
+};
+
+// Bytes of an mmap-ed file, or of a Source read through a large buffer.
+class InputStream {
+public:
+  static constexpr size_t BUFFER_SIZE = 1 << 20;
+
+  explicit InputStream(std::unique_ptr<Source> src)
+      : source(std::move(src)), buffer(BUFFER_SIZE) {}
+  InputStream(const InputStream &) = delete;
+  InputStream &operator=(const InputStream &) = delete;
+  ~InputStream() {
+    if (map != nullptr) {
+      ::munmap(map, map_size);
+    }
+    if (fd >= 0) {
+      ::close(fd);
+    }
+  }
+
+  // Open a file ("-" is stdin).
+  // A regular file is mmap-ed and pipes or devices are read through a buffer.
+  // gzip and xz input is detected and decompressed on the fly.
+  static std::unique_ptr<InputStream> open(const std::string &path) {
+    const bool is_stdin = path == "-";
+    const int file = is_stdin ? 0 : ::open(path.c_str(), O_RDONLY);
+    if (file < 0) {
+      return nullptr;
+    }
+    auto in = std::unique_ptr<InputStream>(new InputStream());
+    in->fd = is_stdin ? -1 : file;
+    struct stat st;
+    if (::fstat(file, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+      const size_t size = static_cast<size_t>(st.st_size);
+      void *addr = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+      if (addr != MAP_FAILED) {
+        ::madvise(addr, size, MADV_SEQUENTIAL);
+        in->map = addr;
+        in->map_size = size;
+        in->view(static_cast<const char *>(addr), size);
+        return in;
+      }
+    }
+    // Read ahead the magic number.
+    auto source = std::make_unique<FdSource>(file);
+    std::vector<char> head(MAGIC_SIZE);
+    size_t n = 0;
+    while (n < head.size()) {
+      const size_t r = source->read(head.data() + n, head.size() - n);
+      if (r == 0) {
+        break;
+      }
+      n += r;
+    }
+    head.resize(n);
+    const Compression compression = detect_compression(head.data(), n);
+    in->decompress(compression, std::make_unique<PrefixSource>(
+                                    std::move(head), std::move(source)));
+    return in;
+  }
+  // The unread input if all of it is in memory (an uncompressed regular file
+  // or from_memory()).
+  [[nodiscard]] std::optional<std::string_view> in_memory() const {
+    if (source || message) {
+      return std::nullopt;
+    }
+    return std::string_view(cur, static_cast<size_t>(end - cur));
+  }
+  // Read `size` bytes at `data`, which have to outlive the stream.
+  static std::unique_ptr<InputStream> from_memory(const char *data,
+                                                  size_t size) {
+    auto in = std::unique_ptr<InputStream>(new InputStream());
+    in->view(data, size);
+    return in;
+  }
+  [[nodiscard]] std::optional<std::string> error() const {
+    if (message) {
+      return message;
     }
+    return source ? source->error() : std::nullopt;
+  }
 
-    return std::nullopt;
+  // EOF at the end
+  int peek() {
+    if (cur == end && !refill()) {
+      return EOF;
+    }
+    return static_cast<unsigned char>(*cur);
   }
+  void advance() { cur++; }
 
-  [[nodiscard]] std::pair<Clause, int> analyze(CRef conflict) {
-    Clause learnt_clause;
-    assert([&]() {
-      bool ok = false;
-      for (const bool b : seen) {
-        ok |= b;
-      }
-      return !ok;
-    }());
-    const int conflicted_decision_level = decision_level();
+private:
+  static constexpr size_t MAGIC_SIZE = 6;
+  InputStream() = default;
+  // Parse bytes in place, or decompress them into the buffer.
+  void view(const char *data, size_t size) {
+    const Compression compression = detect_compression(data, size);
+    if (compression == Compression::None) {
+      cur = data;
+      end = data + size;
+    } else {
+      decompress(compression, std::make_unique<MemorySource>(data, size));
+    }
+  }
+  void decompress(Compression compression, std::unique_ptr<Source> input) {
+    buffer.resize(BUFFER_SIZE);
+    switch (compression) {
+    case Compression::None:
+      source = std::move(input);
+      return;
+    case Compression::Gzip:
+#ifdef BULLSAT_ZLIB
+      source = std::make_unique<GzipSource>(std::move(input));
+#else
+      message = "gzip input is not supported (built without BULLSAT_ZLIB)";
+#endif
+      return;
+    case Compression::Xz:
+#ifdef BULLSAT_LZMA
+      source = std::make_unique<XzSource>(std::move(input));
+#else
+      message = "xz input is not supported (built without BULLSAT_LZMA)";
+#endif
+      return;
+    }
+  }
+  bool refill() {
+    if (!source) {
+      return false;
+    }
+    const size_t n = source->read(buffer.data(), buffer.size());
+    cur = buffer.data();
+    end = cur + n;
+    return n > 0;
+  }
 
-    int counter = 0;
-    {
-      const Clause &clause = *conflict;
+  const char *cur = nullptr;
+  const char *end = nullptr;
+  std::unique_ptr<Source> source;
+  std::vector<char> buffer;
+  std::optional<std::string> message;
+  int fd = -1;
+  void *map = nullptr;
+  size_t map_size = 0;
+};
 
-      // variables that are used to traverse by a conflicted clause
-      for (const Lit &lit : clause) {
-        assert(eval(lit) == LitBool::False);
-        seen[lit.vidx()] = true;
-        var_bump_activity(lit.var(), var_bump_inc);
-        if (levels[lit.vidx()] < conflicted_decision_level) {
-          learnt_clause.emplace_back(lit);
-        } else {
-          counter += 1;
-        }
+// Parse DIMACS CNF.
+// on_header(var_num, clause_num) is called for "p cnf <var_num> <clause_num>"
+// and on_clause(const Clause &) for each clause.
+// Returns an error message if the input is malformed.
+template <typename OnHeader, typename OnClause>
+std::optional<std::string> parse_dimacs(InputStream &in, OnHeader on_header,
+                                        OnClause on_clause) {
+  // Lit(v) requires 2 * v + 1 to fit in int.
+  constexpr uint64_t max_var =
+      static_cast<uint64_t>(std::numeric_limits<int>::max() / 2);
+  size_t line = 1;
+  auto error = [&](const std::string &message) {
+    // Broken compressed data is the likely cause of a syntax error.
+    if (auto source_error = in.error()) {
+      return source_error;
+    }
+    return std::optional<std::string>("line " + std::to_string(line) + ": " +
+                                      message);
+  };
+  auto skip_line = [&]() {
+    int c;
+    while ((c = in.peek()) != EOF && c != '\n') {
+      in.advance();
+    }
+  };
+  auto skip_blank = [&]() {
+    int c;
+    while ((c = in.peek()) == ' ' || c == '\t' || c == '\r') {
+      in.advance();
+    }
+  };
+  auto parse_uint = [&](uint64_t &value, uint64_t max_value) {
+    int c = in.peek();
+    if (c < '0' || c > '9') {
+      return false;
+    }
+    value = 0;
+    while (c >= '0' && c <= '9') {
+      value = value * 10 + static_cast<uint64_t>(c - '0');
+      if (value > max_value) {
+        return false;
       }
-      assert(counter >= 1);
+      in.advance();
+      c = in.peek();
     }
+    return true;
+  };
 
-    // traverse a implication graph to a 1-UIP(first-uinque-implication-point)
-    std::optional<Lit> first_uip = std::nullopt;
-    for (size_t i = que.size() - 1; true; i--) {
-      Lit lit = que[i];
-      // Skip a variable that isn't checked.
-      if (!seen[lit.vidx()]) {
-        continue;
+  Clause clause;
+  while (true) {
+    skip_blank();
+    const int c = in.peek();
+    if (c == EOF) {
+      break;
+    }
+    if (c == '\n') {
+      in.advance();
+      line++;
+    } else if (c == 'c') {
+      // comment
+      skip_line();
+    } else if (c == '%') {
+      // SATLIB instances end with "%\n0\n"
+      break;
+    } else if (c == 'p') {
+      // p cnf 123 567
+      in.advance();
+      skip_blank();
+      for (const char expected : {'c', 'n', 'f'}) {
+        if (in.peek() != expected) {
+          return error("expected 'p cnf <variables> <clauses>'");
+        }
+        in.advance();
       }
-      counter--;
-      if (counter <= 0) {
-        // 1-UIP
-        first_uip = lit;
-        break;
+      uint64_t var_num = 0, clause_num = 0;
+      skip_blank();
+      if (!parse_uint(var_num, max_var)) {
+        return error("invalid number of variables");
       }
-      seen[lit.vidx()] = false;
-
-      assert(reasons[lit.vidx()].has_value());
-      assert(!reasons[lit.vidx()].value().expired());
-      CRef reason = reasons[lit.vidx()].value().lock();
-      const Clause clause = *reason;
-      assert(clause[0] == lit);
-      for (size_t j = 1; j < clause.size(); j++) {
-        Lit clit = clause[j];
-        // Already checked
-        if (seen[clit.vidx()]) {
-          continue;
-        }
-        seen[clit.vidx()] = true;
-        var_bump_activity(lit.var(), var_bump_inc);
-        if (levels[clit.vidx()] < conflicted_decision_level) {
-          learnt_clause.push_back(clit);
-        } else {
-          counter += 1;
-        }
+      skip_blank();
+      if (!parse_uint(clause_num, std::numeric_limits<uint32_t>::max())) {
+        return error("invalid number of clauses");
+      }
+      on_header(static_cast<size_t>(var_num), static_cast<size_t>(clause_num));
+    } else {
+      // 1 2 -3 0
+      bool negative = false;
+      if (c == '-') {
+        negative = true;
+        in.advance();
+      }
+      uint64_t value = 0;
+      if (!parse_uint(value, max_var)) {
+        return error("unexpected character");
+      }
+      if (value == 0) {
+        on_clause(clause);
+        clause.clear();
+      } else {
+        clause.emplace_back(Lit(static_cast<Var>(value - 1), !negative));
       }
     }
-    assert(first_uip.has_value());
-    // learnt_clause[0] = !first_uip
-    learnt_clause.push_back(~(first_uip.value()));
-    std::swap(learnt_clause[0], learnt_clause.back());
+  }
+  if (auto message = in.error()) {
+    return message;
+  }
+  // The last clause without a terminating 0
+  if (!clause.empty()) {
+    on_clause(clause);
+  }
+  return std::nullopt;
+}
 
-    // Back Jump
-    int back_jump_level = 0;
-    for (size_t i = 1; i < learnt_clause.size(); i++) {
-      assert(levels[learnt_clause[i].vidx()].has_value());
-      back_jump_level =
-          std::max(back_jump_level, levels[learnt_clause[i].vidx()].value());
-    }
+// Parse DIMACS CNF straight into a solver.
+template <typename Config>
+std::optional<std::string> load_dimacs(InputStream &in,
+                                       BasicSolver<Config> &solver) {
+  return parse_dimacs(
+      in, [&](size_t var_num, size_t) { solver.new_vars(var_num); },
+      [&](const Clause &clause) { solver.add_clause(clause); });
+}
+// Load DIMACS CNF or a snapshot, which is used in place if it is mmap-ed.
+template <typename Config>
+std::optional<std::string> load_input(InputStream &in,
+                                      BasicSolver<Config> &solver) {
+  if (in.peek() != SNAPSHOT_MAGIC[0]) {
+    return load_dimacs(in, solver);
+  }
+  if (const std::optional<std::string_view> bytes = in.in_memory()) {
+    return solver.load_snapshot(bytes.value().data(), bytes.value().size());
+  }
+  std::string bytes;
+  for (int c = in.peek(); c != EOF; c = in.peek()) {
+    bytes.push_back(static_cast<char>(c));
+    in.advance();
+  }
+  if (auto message = in.error()) {
+    return message;
+  }
+  return solver.load_snapshot(bytes.data(), bytes.size());
+}
 
-    for (const Lit &lit : learnt_clause) {
-      seen[lit.vidx()] = false;
+struct CnfData {
+  std::optional<size_t> var_num;
+  std::optional<size_t> clause_num;
+  std::vector<Clause> clauses;
+};
+inline CnfData parse_cnf(std::istream &stream) {
+  CnfData data = {};
+  InputStream in(std::make_unique<IstreamSource>(stream));
+  const auto error = parse_dimacs(
+      in,
+      [&](size_t var_num, size_t clause_num) {
+        data.var_num = var_num;
+        data.clause_num = clause_num;
+      },
+      [&](const Clause &clause) {
+        if (!clause.empty()) {
+          data.clauses.emplace_back(clause);
+        }
+      });
+  assert(!error.has_value());
+  return data;
+}
+// Parse DIMACS CNF into memory (unlike parse_cnf, empty clauses are kept).
+inline std::optional<std::string> load_dimacs(InputStream &in,
+                                              CnfData &data) {
+  return parse_dimacs(
+      in,
+      [&](size_t var_num, size_t clause_num) {
+        data.var_num = var_num;
+        data.clause_num = clause_num;
+        data.clauses.reserve(clause_num);
+      },
+      [&](const Clause &clause) { data.clauses.emplace_back(clause); });
+}
+// Whether `model` satisfies every clause of `cnf`.
+inline bool check_model(const CnfData &cnf, const std::vector<bool> &model) {
+  size_t var_num = cnf.var_num.value_or(0);
+  for (const Clause &clause : cnf.clauses) {
+    for (const Lit lit : clause) {
+      var_num = std::max(var_num, lit.vidx() + 1);
     }
+  }
+  const std::vector<LitBool> values = model_values(model, var_num);
+  return std::all_of(
+      cnf.clauses.begin(), cnf.clauses.end(), [&](const Clause &clause) {
+        return find_value<true>(clause.data(), clause.size(), values.data(),
+                                LitBool::True) < clause.size();
+      });
+}
 
-    return std::make_pair(learnt_clause, back_jump_level);
+// Options of a portfolio worker. Worker 0 runs `base` as it is and the
+// others vary restarts, branching and phases.
+inline SolverOptions portfolio_options(const SolverOptions &base,
+                                       size_t worker) {
+  SolverOptions options = base;
+  if (worker == 0) {
+    return options;
   }
-  bool locked(const CRef &cr) {
-    const Clause &clause = *cr;
+  constexpr RestartPolicy restarts[] = {
+      RestartPolicy::Glucose, RestartPolicy::Luby, RestartPolicy::Geometric};
+  constexpr BranchingHeuristic branchings[] = {BranchingHeuristic::Evsids,
+                                               BranchingHeuristic::Switch,
+                                               BranchingHeuristic::Vmtf};
+  options.restart = restarts[worker % 3];
+  options.branching = branchings[(worker / 3) % 3];
+  options.initial_phase = worker % 2 == 1;
+  options.target_phase = worker % 4 >= 2;
+  options.seed = base.seed + worker;
+  return options;
+}
+
+// Solve a formula with differently configured solvers on threads.
+// They share learnt clauses through ClauseExchange and the first answer
+// interrupts the rest.
+class Portfolio {
+public:
+  Portfolio(size_t workers, const SolverOptions &base)
+      : num_workers(std::max<size_t>(workers, 1)), base_options(base) {}
 
-    if (eval(clause[0]) == LitBool::True &&
-        reasons[clause[0].vidx()].has_value()) {
-      // A clause is being propagated.
-      assert(!reasons[clause[0].vidx()].value().expired());
-      return reasons[clause[0].vidx()].value().lock() == cr;
+  // `cnf` is read by every worker and isn't modified.
+  Status solve(const CnfData &cnf) {
+    const size_t var_num = cnf.var_num.value_or(0);
+    ClauseExchange exchange(num_workers);
+    std::vector<std::unique_ptr<Solver>> solvers;
+    for (size_t w = 0; w < num_workers; w++) {
+      solvers.push_back(std::make_unique<Solver>(
+          var_num, portfolio_options(base_options, w)));
+      solvers.back()->share_clauses(exchange, w);
+      solvers.back()->set_budget(budget);
     }
-    return false;
+    std::atomic<size_t> first{NO_WINNER};
+    std::vector<Status> results(num_workers, Status::Unknown);
+    std::vector<std::thread> threads;
+    for (size_t w = 0; w < num_workers; w++) {
+      threads.emplace_back([&, w]() {
+        Solver &solver = *solvers[w];
+        for (const Clause &clause : cnf.clauses) {
+          solver.add_clause(clause);
+        }
+        results[w] = solver.solve();
+        if (results[w] == Status::Unknown) {
+          // interrupted or out of budget
+          return;
+        }
+        size_t expected = NO_WINNER;
+        if (first.compare_exchange_strong(expected, w)) {
+          for (const auto &other : solvers) {
+            other->interrupt();
+          }
+        }
+      });
+    }
+    for (std::thread &thread : threads) {
+      thread.join();
+    }
+    if (first.load() == NO_WINNER) {
+      return Status::Unknown;
+    }
+    winner = first.load();
+    Solver &solver = *solvers[winner.value()];
+    assings = solver.assings;
+    stats = solver.stats;
+    return results[winner.value()];
   }
-  void reduce_learnts() {
-    std::sort(learnts.begin(), learnts.end(),
-              [](const auto &left, const auto &right) {
-                return left->size() < right->size();
-              });
-    size_t new_size = learnts.size() / 2;
-    std::unordered_set<CRef> crs;
-    for (size_t i = new_size; i < learnts.size(); i++) {
-      if (learnts[i]->size() > 2 && !locked(learnts[i])) {
-        unwatch_clause(learnts[i]);
-        crs.insert(learnts[i]);
-      } else {
-        learnts[new_size] = learnts[i];
-        new_size++;
+
+  // a model if the status is Sat
+  std::vector<bool> assings;
+  // the worker that answered
+  std::optional<size_t> winner;
+  // statistics of the winner
+  Stats stats;
+  // the budget of every worker from the start of solve()
+  Budget budget;
+
+private:
+  static constexpr size_t NO_WINNER = std::numeric_limits<size_t>::max();
+  size_t num_workers;
+  SolverOptions base_options;
+};
+
+// Split a formula into cubes (conjunctions of literals) by lookahead.
+// The branching variable maximizes the product of the numbers of literals
+// propagated by its polarities, and a polarity that fails is forced. Every
+// model satisfies one of the cubes. Refuted branches are dropped, so no
+// cube means Unsat.
+class CubeGenerator {
+public:
+  CubeGenerator(const CnfData &cnf, size_t max_depth)
+      : solver(cnf.var_num.value_or(0), lookahead_options()),
+        depth(max_depth) {
+    for (const Clause &clause : cnf.clauses) {
+      solver.add_clause(clause);
+    }
+    // Look ahead on frequent variables.
+    std::vector<size_t> occurrences(solver.num_vars(), 0);
+    for (const Clause &clause : cnf.clauses) {
+      for (const Lit lit : clause) {
+        occurrences[lit.vidx()]++;
       }
     }
-    learnts.resize(new_size);
+    for (size_t v = 0; v < solver.num_vars(); v++) {
+      order.push_back(Var(v));
+    }
+    std::stable_sort(order.begin(), order.end(), [&](Var left, Var right) {
+      return occurrences[static_cast<size_t>(left)] >
+             occurrences[static_cast<size_t>(right)];
+    });
   }
 
-  void simplify() {
-    assert(decision_level() == 0);
-    auto remove_satisfied = [&](std::vector<CRef> &cls) {
-      // learnts
-      size_t new_cls_size = 0;
-      for (size_t i = 0; i < cls.size(); i++) {
-        CRef cr = cls[i];
-        const Clause &clause = *cr;
-        bool satisfied = false;
-        for (size_t j = 0; j < clause.size(); j++) {
-          LitBool lb = eval(clause[j]);
-          if (lb == LitBool::True) {
-            unwatch_clause(cr);
-            satisfied = true;
-            break;
-          }
-        }
+  std::vector<std::vector<Lit>> generate() {
+    std::vector<std::vector<Lit>> cubes;
+    std::vector<Lit> cube;
+    if (solver.status != Status::Unsat) {
+      split(cube, 0, cubes);
+    }
+    return cubes;
+  }
 
-        if (!satisfied) {
-          cls[new_cls_size] = cr;
-          new_cls_size++;
-        }
-      }
-      cls.resize(new_cls_size);
-    };
+private:
+  // the number of literals looked ahead at a node
+  static constexpr size_t CANDIDATES = 32;
+  static constexpr size_t FAILED = std::numeric_limits<size_t>::max();
 
-    remove_satisfied(learnts);
-    remove_satisfied(clauses);
+  static SolverOptions lookahead_options() {
+    SolverOptions options;
+    options.preprocess = false;
+    return options;
   }
-  Status solve() {
-    if (status) {
-      return status.value();
+  // Every literal of `cube` is decided and `branches` of them are branches.
+  void split(std::vector<Lit> &cube, size_t branches,
+             std::vector<std::vector<Lit>> &cubes) {
+    const int level = solver.decision_level();
+    const size_t size = cube.size();
+    if (const std::optional<Var> best = branch_var(cube, branches, cubes)) {
+      for (const bool positive : {true, false}) {
+        const Lit lit = Lit(best.value(), positive);
+        cube.push_back(lit);
+        solver.new_decision(lit);
+        split(cube, branches + 1, cubes);
+        solver.pop_queue_until(solver.decision_level() - 1, false);
+        cube.pop_back();
+      }
     }
-    double max_limit_learnts = static_cast<double>(clauses.size()) * 0.3;
-    size_t conflict_cnt = 0;
-    double restart_limit = 100;
+    solver.pop_queue_until(level, false);
+    cube.resize(size);
+  }
+  // Decide the literals forced by failed lookaheads, then pick the variable
+  // to branch on. std::nullopt if the cube is refuted or complete, in which
+  // case a complete one is added to `cubes`.
+  std::optional<Var> branch_var(std::vector<Lit> &cube, size_t branches,
+                                std::vector<std::vector<Lit>> &cubes) {
     while (true) {
-      if (std::optional<CRef> conflict = propagate()) {
-        // Conflict
-        conflict_cnt++;
-        if (decision_level() == 0) {
-          status = Status::Unsat;
-          return Status::Unsat;
-        }
-        auto [learnt_clause, back_jump_level] = analyze(conflict.value());
-        pop_queue_until(back_jump_level);
-        if (learnt_clause.size() == 1) {
-          enqueue(learnt_clause[0]);
-          // a unit clause can simplify clauses
-          // (!x1)
-          // Delete: (!x1 v x2 v x3)
-          skip_simplify = false;
-        } else {
-          CRef cr = std::make_shared<Clause>(learnt_clause);
-          attach_clause(cr, true);
-          enqueue(learnt_clause[0], cr);
+      if (solver.propagate()) {
+        // refuted
+        return std::nullopt;
+      }
+      if (branches == depth) {
+        cubes.push_back(cube);
+        return std::nullopt;
+      }
+      std::optional<Lit> forced;
+      std::optional<Var> best;
+      bool refuted = false;
+      double best_score = -1;
+      size_t looked = 0;
+      for (const Var v : order) {
+        if (looked == CANDIDATES) {
+          break;
         }
-
-        var_bump_inc *= (1.0 / 0.95);
-      } else {
-        // No Conflict
-        if (conflict_cnt >= static_cast<size_t>(restart_limit)) {
-          restart_limit *= 1.1;
-          // pop_queue_until(0);
+        if (solver.eval(Lit(v, true)) != LitBool::Undefine) {
+          continue;
         }
-
-        if (!skip_simplify && decision_level() == 0) {
-          // simplify clauses at the top level.
-          simplify();
-          skip_simplify = true;
+        looked++;
+        const size_t pos = lookahead(Lit(v, true));
+        const size_t neg = lookahead(Lit(v, false));
+        if (pos == FAILED && neg == FAILED) {
+          refuted = true;
+          break;
         }
-
-        if (learnts.size() >= static_cast<size_t>(max_limit_learnts)) {
-          // Reduce the set of learnt clauses
-          max_limit_learnts *= 1.1;
-          reduce_learnts();
+        if (pos == FAILED || neg == FAILED) {
+          forced = Lit(v, pos != FAILED);
+          break;
         }
-        while (true) {
-          // std::cout << std::endl;
-          if (std::optional<Var> v = order_heap.pop()) {
-            const size_t idx = static_cast<size_t>(v.value());
-            if (levels[idx].has_value()) {
-              continue;
-            }
-
-            Lit next = Lit(v.value(), assings[idx]);
-            new_decision(next);
-            break;
-          } else {
-            status = Status::Sat;
-            return Status::Sat;
-          }
+        const double score = static_cast<double>(pos + 1) *
+                             static_cast<double>(neg + 1);
+        if (score > best_score) {
+          best_score = score;
+          best = v;
         }
       }
+      if (refuted) {
+        return std::nullopt;
+      }
+      if (forced) {
+        cube.push_back(forced.value());
+        solver.new_decision(forced.value());
+        continue;
+      }
+      if (!best) {
+        // All variables are assigned: the cube is a model.
+        cubes.push_back(cube);
+      }
+      return best;
     }
-    status = Status::Unknown;
-    return Status::Unknown;
   }
-  // All variables
-public:
-  std::vector<bool> assings;
-  std::optional<Status> status;
-
-private:
-  std::vector<CRef> clauses, learnts;
-  std::vector<std::vector<CWRef>> watchers;
-  std::vector<std::optional<CWRef>> reasons;
-  std::vector<std::optional<int>> levels;
-  std::vector<bool> seen;
-  bool skip_simplify;
+  // the number of literals implied by `lit`, or FAILED on a conflict
+  size_t lookahead(Lit lit) {
+    const int level = solver.decision_level();
+    const size_t before = solver.num_assigned();
+    solver.new_decision(lit);
+    const bool failed = solver.propagate().has_value();
+    const size_t implied = solver.num_assigned() - before;
+    solver.pop_queue_until(level, false);
+    return failed ? FAILED : implied;
+  }
 
-  std::deque<Lit> que;
-  size_t que_head;
-  Heap order_heap;
-  double var_bump_inc;
-};
-struct CnfData {
-  std::optional<size_t> var_num;
-  std::optional<size_t> clause_num;
-  std::vector<Clause> clauses;
+  Solver solver;
+  size_t depth;
+  std::vector<Var> order;
 };
-CnfData parse_cnf(std::istream &in) {
-  std::string line;
-  const std::regex pattern("p cnf (\\d+) (\\d+)");
-  CnfData data = {};
-  while (std::getline(in, line)) {
-    std::stringstream stream(line);
-    std::string word;
 
-    std::vector<std::string> words;
+// Cube-and-conquer: solve the cubes of CubeGenerator on threads.
+// Every worker keeps one Solver and solves its cubes under assumptions, so
+// learnt clauses carry over from a cube to the next. A worker that runs out
+// of cubes steals from the front of another worker's queue.
+class CubeAndConquer {
+public:
+  CubeAndConquer(size_t workers, size_t cube_depth, const SolverOptions &base)
+      : num_workers(std::max<size_t>(workers, 1)), depth(cube_depth),
+        base_options(base) {}
 
-    while (std::getline(stream, word, ' ')) {
-      if (word.empty()) {
-        continue;
-      }
-      words.push_back(word);
+  Status solve(const CnfData &cnf) {
+    const std::vector<std::vector<Lit>> cubes =
+        CubeGenerator(cnf, depth).generate();
+    num_cubes = cubes.size();
+    if (cubes.empty()) {
+      return Status::Unsat;
     }
-    if (words.empty() || words[0] == "c") {
-      continue;
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    for (size_t w = 0; w < num_workers; w++) {
+      queues.push_back(std::make_unique<WorkQueue>());
+    }
+    for (size_t i = 0; i < cubes.size(); i++) {
+      queues[i % num_workers]->cubes.push_back(i);
+    }
+    ClauseExchange exchange(num_workers);
+    std::vector<std::unique_ptr<Solver>> solvers;
+    for (size_t w = 0; w < num_workers; w++) {
+      solvers.push_back(std::make_unique<Solver>(
+          cnf.var_num.value_or(0), portfolio_options(base_options, w)));
+      solvers.back()->share_clauses(exchange, w);
+      solvers.back()->set_budget(budget);
+      // Cube variables must survive variable elimination.
+      for (const std::vector<Lit> &cube : cubes) {
+        for (const Lit lit : cube) {
+          solvers.back()->freeze(lit.var());
+        }
+      }
     }
 
-    line = std::accumulate(
-        std::next(words.begin()), words.end(), words[0],
-        [](std::string left, std::string right) { return left + " " + right; });
-    std::smatch matches;
-
-    // p cnf 123 567
-    if (std::regex_match(line, matches, pattern)) {
-      int var_num = std::stoi(matches[1]);
-      int clause_num = std::stoi(matches[2]);
-      if (var_num >= 0 && clause_num >= 0) {
-        data.var_num = var_num;
-        data.clause_num = clause_num;
+    std::atomic<size_t> refuted{0};
+    std::atomic<size_t> first{NO_WINNER};
+    std::vector<Status> results(num_workers, Status::Unknown);
+    auto finish = [&](size_t w, Status result) {
+      size_t expected = NO_WINNER;
+      if (first.compare_exchange_strong(expected, w)) {
+        results[w] = result;
+        for (const auto &other : solvers) {
+          other->interrupt();
+        }
       }
-      continue;
+    };
+    std::vector<std::thread> threads;
+    for (size_t w = 0; w < num_workers; w++) {
+      threads.emplace_back([&, w]() {
+        Solver &solver = *solvers[w];
+        for (const Clause &clause : cnf.clauses) {
+          solver.add_clause(clause);
+        }
+        while (first.load() == NO_WINNER) {
+          const std::optional<size_t> cube = take(queues, w);
+          if (!cube) {
+            break;
+          }
+          const Status result = solver.solve(cubes[cube.value()]);
+          if (result == Status::Sat) {
+            finish(w, Status::Sat);
+          } else if (result == Status::Unsat) {
+            if (solver.status == Status::Unsat) {
+              // refuted without assumptions
+              finish(w, Status::Unsat);
+            } else if (++refuted == cubes.size()) {
+              finish(w, Status::Unsat);
+            }
+          } else {
+            // interrupted or out of budget
+            break;
+          }
+        }
+      });
     }
-    // Parse a clause from line.
-    // 1 2 -3 0
-    Clause clause = Clause();
-    for (const auto &w : words) {
-      if (w == "0") {
-        break;
+    for (std::thread &thread : threads) {
+      thread.join();
+    }
+    if (first.load() == NO_WINNER) {
+      return Status::Unknown;
+    }
+    winner = first.load();
+    assings = solvers[winner.value()]->assings;
+    stats = solvers[winner.value()]->stats;
+    return results[winner.value()];
+  }
+
+  // a model if the status is Sat
+  std::vector<bool> assings;
+  // the worker that answered
+  std::optional<size_t> winner;
+  // statistics of the winner
+  Stats stats;
+  // the budget of every worker from the start of solve()
+  Budget budget;
+  size_t num_cubes = 0;
+
+private:
+  static constexpr size_t NO_WINNER = std::numeric_limits<size_t>::max();
+  struct WorkQueue {
+    std::mutex mutex;
+    std::deque<size_t> cubes;
+  };
+  // The owner takes the back and thieves take the front.
+  static std::optional<size_t>
+  take(std::vector<std::unique_ptr<WorkQueue>> &queues, size_t worker) {
+    for (size_t i = 0; i < queues.size(); i++) {
+      WorkQueue &queue = *queues[(worker + i) % queues.size()];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      if (queue.cubes.empty()) {
+        continue;
       }
-      int num = std::stoi(w);
-      assert(num != 0);
-      int d = std::abs(num) - 1;
-      if (num > 0) {
-        clause.emplace_back(Lit(d, true));
+      size_t cube;
+      if (i == 0) {
+        cube = queue.cubes.back();
+        queue.cubes.pop_back();
       } else {
-        clause.emplace_back(Lit(d, false));
+        cube = queue.cubes.front();
+        queue.cubes.pop_front();
       }
+      return cube;
     }
-    if (!clause.empty()) {
-      data.clauses.emplace_back(clause);
-    }
+    return std::nullopt;
   }
-  return data;
-}
+
+  size_t num_workers;
+  size_t depth;
+  SolverOptions base_options;
+};
 } // namespace bullsat
 
 #endif // BULLSAT_HPP_
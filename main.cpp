@@ -1,16 +1,190 @@
 #include "bullsat.hpp"
+#include <chrono>
+#include <condition_variable>
 #include <cstdlib>
+#include <deque>
 #include <fstream>
 #include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <vector>
 using namespace bullsat;
 void help() {
-  std::cout << "Usage: bullsat <input-file> [output-file]" << std::endl;
+  std::cout << "Usage: bullsat [options] <input-file|-> [output-file]"
+            << std::endl;
+  std::cout << "Options:" << std::endl;
+  std::cout << "  --restart=<none|geometric|luby|glucose> (default: glucose)"
+            << std::endl;
+  std::cout << "  --branching=<evsids|vmtf|switch> (default: evsids)"
+            << std::endl;
+  std::cout << "  --preprocess=<yes|no> (default: yes)" << std::endl;
+  std::cout << "  --inprocess=<yes|no> (default: yes)" << std::endl;
+  std::cout << "  --chrono=<yes|no> (default: no, chronological backtracking)"
+            << std::endl;
+  std::cout << "  --walk=<yes|no> (default: yes, local search)" << std::endl;
+  std::cout << "  --threads=<n> (default: 1, portfolio solvers if n > 1)"
+            << std::endl;
+  std::cout << "  --batch=<args|list|stream> (default: off, solve many inputs "
+               "on threads)"
+            << std::endl;
+  std::cout << "  --cube-depth=<d> (default: off, cube-and-conquer on threads)"
+            << std::endl;
+  std::cout << "  --conflict-limit=<n> (default: none)" << std::endl;
+  std::cout << "  --time-limit=<seconds> (default: none)" << std::endl;
+  std::cout << "  --memory-limit=<MiB> (default: none, per solver)"
+            << std::endl;
+  std::cout << "  --stats=<yes|no> (default: no)" << std::endl;
+  std::cout << "  --progress=<seconds> (default: off, a single solver only)"
+            << std::endl;
+  std::cout << "  --check=<yes|no> (default: no, check a model)" << std::endl;
+  std::cout << "  --proof=<file> (DRAT, a single solver only)" << std::endl;
+  std::cout << "  --binary-proof=<yes|no> (default: no)" << std::endl;
+  std::cout << "  --write-snapshot=<file> (binary clauses for a fast reload, "
+               "a single solver only)"
+            << std::endl;
 }
 
-void write_result(const Solver &solver, Status status, std::ostream &os,
-                  bool tostdout) {
+std::optional<RestartPolicy> parse_restart(const std::string &name) {
+  if (name == "none") {
+    return RestartPolicy::None;
+  } else if (name == "geometric") {
+    return RestartPolicy::Geometric;
+  } else if (name == "luby") {
+    return RestartPolicy::Luby;
+  } else if (name == "glucose") {
+    return RestartPolicy::Glucose;
+  }
+  return std::nullopt;
+}
+
+std::optional<BranchingHeuristic> parse_branching(const std::string &name) {
+  if (name == "evsids") {
+    return BranchingHeuristic::Evsids;
+  } else if (name == "vmtf") {
+    return BranchingHeuristic::Vmtf;
+  } else if (name == "switch") {
+    return BranchingHeuristic::Switch;
+  }
+  return std::nullopt;
+}
+
+std::optional<bool> parse_bool(const std::string &name) {
+  if (name == "yes") {
+    return true;
+  } else if (name == "no") {
+    return false;
+  }
+  return std::nullopt;
+}
+
+std::optional<size_t> parse_count(const std::string &value) {
+  if (value.empty() || value.size() > 18 ||
+      value.find_first_not_of("0123456789") != std::string::npos) {
+    return std::nullopt;
+  }
+  const size_t n = std::stoull(value);
+  return n > 0 ? std::optional<size_t>(n) : std::nullopt;
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+void write_progress(const Stats &stats, double seconds) {
+  std::cout << "c [" << seconds << "s] conflicts: " << stats.conflicts
+            << " decisions: " << stats.decisions
+            << " propagations: " << stats.propagations
+            << " restarts: " << stats.restarts
+            << " learnts: " << stats.learnts_added - stats.learnts_deleted
+            << " lbd: " << stats.average_lbd() << std::endl;
+}
+
+void write_stats(const Stats &stats, double seconds, std::ostream &os) {
+  auto line = [&os](const std::string &name, auto value) {
+    os << "c " << name << ": " << value << "\n";
+  };
+  line("conflicts", stats.conflicts);
+  line("decisions", stats.decisions);
+  line("propagations", stats.propagations);
+  line("restarts", stats.restarts);
+  line("rephases", stats.rephases);
+  line("chrono backtracks", stats.chrono_backtracks);
+  line("learnts added", stats.learnts_added);
+  line("learnts deleted", stats.learnts_deleted);
+  line("average lbd", stats.average_lbd());
+  line("reductions", stats.reductions);
+  line("simplifications", stats.simplifications);
+  line("failed literals", stats.failed_literals);
+  line("subsumed", stats.subsumed);
+  line("strengthened", stats.strengthened);
+  line("eliminated", stats.eliminated);
+  line("inprocessings", stats.inprocessings);
+  line("vivified", stats.vivified);
+  line("duplicate binaries", stats.duplicate_binaries);
+  line("walks", stats.walks);
+  line("walk flips", stats.walk_flips);
+  line("exported", stats.exported);
+  line("imported", stats.imported);
+  line("memory bytes", stats.memory_bytes);
+  line("memory reductions", stats.memory_reductions);
+  if (DefaultConfig::profile) {
+    line("propagate seconds", stats.propagate_seconds);
+    line("analyze seconds", stats.analyze_seconds);
+    line("reduce seconds", stats.reduce_seconds);
+  }
+  line("total seconds", seconds);
+  os.flush();
+}
+
+// The model as `v` lines of at most MODEL_LINE characters, or on one line
+// for an output file. It goes out in chunks instead of as one string.
+void write_model(const std::vector<bool> &assigns, std::ostream &os,
+                 bool v_lines) {
+  constexpr size_t MODEL_LINE = 80;
+  // " -" and 10 digits
+  constexpr size_t MAX_WORD = 12;
+  constexpr size_t CHUNK = 1 << 16;
+  OutputBuffer out;
+  out.reserve(CHUNK + MODEL_LINE + 2);
+  // the length of the current line
+  size_t line = 0;
+  auto put = [&](int64_t n) {
+    if (v_lines && line + MAX_WORD > MODEL_LINE) {
+      out.append('\n');
+      line = 0;
+    }
+    const size_t before = out.size();
+    if (v_lines && line == 0) {
+      out.append('v');
+    }
+    if (v_lines || line > 0) {
+      out.append(' ');
+    }
+    out.append_int(n);
+    line += out.size() - before;
+    if (out.size() >= CHUNK) {
+      out.write_to(os);
+    }
+  };
+  for (size_t v = 0; v < assigns.size(); v++) {
+    const int64_t dimacs = static_cast<int64_t>(v) + 1;
+    put(assigns[v] ? dimacs : -dimacs);
+  }
+  put(0);
+  out.append('\n');
+  out.write_to(os);
+}
+
+void write_result(const std::vector<bool> &assigns, Status status,
+                  std::ostream &os, bool tostdout) {
   std::string result;
   if (status == Status::Sat) {
     result = "SAT";
@@ -21,43 +195,532 @@ void write_result(const Solver &solver, Status status, std::ostream &os,
   }
 
   if (tostdout) {
-    os << "s " << result << std::endl;
+    os << "s " << result << "\n";
   } else {
-    os << result << std::endl;
+    os << result << "\n";
   }
   if (status == Status::Sat) {
-    std::string assigns = "";
-    for (size_t v = 0; v < solver.assings.size(); v++) {
-      if (solver.assings[v]) {
-        assigns += std::to_string(v + 1) + " ";
-      } else {
-        assigns += "-" + std::to_string(v + 1) + " ";
+    write_model(assigns, os, tostdout);
+  }
+  os.flush();
+}
+
+[[noreturn]] void parse_error(const std::string &file,
+                              const std::string &error) {
+  std::cerr << "c parse error: " << file << ": " << error << std::endl;
+  std::exit(1);
+}
+
+// The settings of a single solver besides SolverOptions.
+struct RunSettings {
+  Budget budget;
+  std::optional<size_t> progress;
+  bool check = false;
+  std::optional<std::string> proof_file;
+  bool binary_proof = false;
+  std::optional<std::string> snapshot_file;
+  std::chrono::steady_clock::time_point start;
+};
+
+struct Outcome {
+  Status status = Status::Unknown;
+  std::vector<bool> assigns;
+  Stats stats;
+  bool model_ok = true;
+};
+
+template <typename Config>
+Outcome run_solver(std::unique_ptr<InputStream> &input,
+                   const std::string &file, SolverOptions options,
+                   const RunSettings &run) {
+  options.keep_input_clauses = run.check;
+  BasicSolver<Config> solver = BasicSolver<Config>(0, options);
+  std::ofstream proof_stream;
+  std::unique_ptr<ProofWriter> proof;
+  if constexpr (Config::proof) {
+    if (run.proof_file) {
+      proof_stream.open(run.proof_file.value(), std::ios::binary);
+      if (!proof_stream) {
+        std::cerr << "c cannot open " << run.proof_file.value() << std::endl;
+        std::exit(1);
+      }
+      proof = std::make_unique<ProofWriter>(proof_stream, run.binary_proof);
+      solver.write_proof(*proof);
+    }
+  }
+  solver.set_budget(run.budget);
+  if (run.progress) {
+    const auto start = run.start;
+    solver.set_progress(static_cast<double>(run.progress.value()),
+                        [start](const Stats &current) {
+                          write_progress(current, seconds_since(start));
+                        });
+  }
+  if (auto error = load_input(*input, solver)) {
+    parse_error(file, error.value());
+  }
+  input.reset();
+  if (run.snapshot_file) {
+    std::ofstream snapshot(run.snapshot_file.value(), std::ios::binary);
+    if (!snapshot) {
+      std::cerr << "c cannot open " << run.snapshot_file.value() << std::endl;
+      std::exit(1);
+    }
+    solver.write_snapshot(snapshot);
+  }
+  Outcome outcome;
+  outcome.status = solver.solve();
+  if (run.check && outcome.status == Status::Sat) {
+    outcome.model_ok = solver.check_model();
+  }
+  outcome.assigns = std::move(solver.assings);
+  outcome.stats = solver.stats;
+  return outcome;
+}
+
+using Runner = Outcome (*)(std::unique_ptr<InputStream> &, const std::string &,
+                           SolverOptions, const RunSettings &);
+
+// Solvers compiled for common options, with the restart policy and the
+// branching heuristic fixed. Other options and proofs run DefaultConfig.
+struct Specialized {
+  RestartPolicy restart;
+  BranchingHeuristic branching;
+  Runner run;
+};
+constexpr Specialized SPECIALIZED[] = {
+    {RestartPolicy::Glucose, BranchingHeuristic::Evsids,
+     run_solver<
+         SearchConfig<RestartPolicy::Glucose, BranchingHeuristic::Evsids>>},
+    {RestartPolicy::Glucose, BranchingHeuristic::Vmtf,
+     run_solver<
+         SearchConfig<RestartPolicy::Glucose, BranchingHeuristic::Vmtf>>},
+    {RestartPolicy::Luby, BranchingHeuristic::Switch,
+     run_solver<
+         SearchConfig<RestartPolicy::Luby, BranchingHeuristic::Switch>>},
+};
+
+Runner select_runner(const SolverOptions &options, bool proof) {
+  if (!proof) {
+    for (const Specialized &specialized : SPECIALIZED) {
+      if (specialized.restart == options.restart &&
+          specialized.branching == options.branching) {
+        return specialized.run;
+      }
+    }
+  }
+  return run_solver<DefaultConfig>;
+}
+
+// Where batch mode takes its inputs from: the command line, a list of paths
+// on stdin, or length-prefixed formulas on stdin.
+enum class BatchInput { Args, List, Stream };
+
+std::optional<BatchInput> parse_batch(const std::string &name) {
+  if (name == "args") {
+    return BatchInput::Args;
+  } else if (name == "list") {
+    return BatchInput::List;
+  } else if (name == "stream") {
+    return BatchInput::Stream;
+  }
+  return std::nullopt;
+}
+
+// Solves formulas on a pool of single solvers. A worker resets its solver
+// for the next formula so that clause and watcher memory is reused. Results
+// go to `out` in the order of submit() as soon as the earlier ones are done.
+class Batch {
+public:
+  Batch(size_t workers, const SolverOptions &solver_options,
+        const RunSettings &settings, bool stats, std::ostream &os)
+      : options(solver_options), run(settings), print_stats(stats), out(os) {
+    options.keep_input_clauses = run.check;
+    for (size_t i = 0; i < workers; i++) {
+      threads.emplace_back([this] { work(); });
+    }
+  }
+  Batch(const Batch &) = delete;
+  Batch &operator=(const Batch &) = delete;
+  ~Batch() { finish(); }
+
+  // Solve the file `name`, or `data` if given. Waits while too many results
+  // are waiting for an earlier one.
+  void submit(std::string name, std::optional<std::string> data) {
+    std::unique_lock<std::mutex> lock(mutex);
+    written.wait(lock, [&] {
+      return submitted - next_write < MAX_PENDING * threads.size();
+    });
+    jobs.push_back(Job{submitted++, std::move(name), std::move(data)});
+    queued.notify_one();
+  }
+  // Wait for every result. Returns false if an input couldn't be solved.
+  bool finish() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      closed = true;
+    }
+    queued.notify_all();
+    for (std::thread &thread : threads) {
+      thread.join();
+    }
+    threads.clear();
+    return !failed;
+  }
+
+private:
+  // results in flight per worker
+  static constexpr size_t MAX_PENDING = 4;
+  struct Job {
+    size_t id;
+    std::string name;
+    std::optional<std::string> data;
+  };
+
+  void work() {
+    Solver solver = Solver(0, options);
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+      queued.wait(lock, [&] { return !jobs.empty() || closed; });
+      if (jobs.empty()) {
+        return;
+      }
+      Job job = std::move(jobs.front());
+      jobs.pop_front();
+      lock.unlock();
+      bool ok = true;
+      std::string result = solve(solver, job, ok);
+      lock.lock();
+      failed = failed || !ok;
+      results.emplace(job.id, std::move(result));
+      for (auto it = results.find(next_write); it != results.end();
+           it = results.find(next_write)) {
+        out << it->second;
+        results.erase(it);
+        next_write++;
+      }
+      out.flush();
+      written.notify_all();
+    }
+  }
+  std::string solve(Solver &solver, const Job &job, bool &ok) {
+    const auto start = std::chrono::steady_clock::now();
+    std::ostringstream os;
+    os << "c " << job.name << "\n";
+    solver.reset(0, options);
+    solver.set_budget(run.budget);
+    auto input = job.data ? InputStream::from_memory(job.data.value().data(),
+                                                     job.data.value().size())
+                          : InputStream::open(job.name);
+    Status status = Status::Unknown;
+    if (!input) {
+      os << "c cannot open " << job.name << "\n";
+      ok = false;
+    } else if (auto error = load_input(*input, solver)) {
+      os << "c parse error: " << job.name << ": " << error.value() << "\n";
+      ok = false;
+    } else {
+      input.reset();
+      status = solver.solve();
+      if (run.check && status == Status::Sat && !solver.check_model()) {
+        os << "c model check failed\n";
+        status = Status::Unknown;
+        ok = false;
+      }
+      if (print_stats) {
+        write_stats(solver.stats, seconds_since(start), os);
       }
     }
-    assigns += "0";
-    os << assigns << std::endl;
+    write_result(solver.assings, status, os, true);
+    return os.str();
+  }
+
+  SolverOptions options;
+  RunSettings run;
+  bool print_stats;
+  std::ostream &out;
+  std::vector<std::thread> threads;
+  std::mutex mutex;
+  std::condition_variable queued, written;
+  std::deque<Job> jobs;
+  // finished results waiting for an earlier one
+  std::map<size_t, std::string> results;
+  size_t submitted = 0, next_write = 0;
+  bool closed = false;
+  bool failed = false;
+};
+
+// Submit the inputs of batch mode. A stream is formulas each preceded by a
+// line with its size in bytes, e.g. from a pipe or a socket.
+void submit_batch(Batch &batch, BatchInput from,
+                  const std::vector<std::string> &files) {
+  if (from == BatchInput::Args) {
+    for (const std::string &file : files) {
+      batch.submit(file, std::nullopt);
+    }
+    return;
+  }
+  std::string line;
+  for (size_t count = 1; std::getline(std::cin, line); count++) {
+    if (from == BatchInput::List) {
+      if (!line.empty()) {
+        batch.submit(line, std::nullopt);
+      }
+      continue;
+    }
+    const std::optional<size_t> size = parse_count(line);
+    if (!size && line != "0") {
+      std::cerr << "c bad size of formula " << count << ": " << line
+                << std::endl;
+      std::exit(1);
+    }
+    std::string data(size.value_or(0), '\0');
+    std::cin.read(data.data(), static_cast<std::streamsize>(data.size()));
+    if (static_cast<size_t>(std::cin.gcount()) != data.size()) {
+      std::cerr << "c formula " << count << " is cut short" << std::endl;
+      std::exit(1);
+    }
+    batch.submit("#" + std::to_string(count), std::move(data));
   }
 }
+
 int main(int argc, char *argv[]) {
-  if (!(argc == 2 || argc == 3)) {
+  SolverOptions options;
+  size_t threads = 1;
+  size_t cube_depth = 0;
+  std::optional<BatchInput> batch;
+  Budget budget;
+  bool print_stats = false;
+  std::optional<size_t> progress;
+  bool check = false;
+  std::optional<std::string> proof_file;
+  bool binary_proof = false;
+  std::optional<std::string> snapshot_file;
+  std::vector<std::string> files;
+  for (int i = 1; i < argc; i++) {
+    const std::string arg = argv[i];
+    const std::string restart_opt = "--restart=";
+    const std::string branching_opt = "--branching=";
+    const std::string preprocess_opt = "--preprocess=";
+    const std::string inprocess_opt = "--inprocess=";
+    const std::string chrono_opt = "--chrono=";
+    const std::string walk_opt = "--walk=";
+    const std::string threads_opt = "--threads=";
+    const std::string cube_depth_opt = "--cube-depth=";
+    const std::string batch_opt = "--batch=";
+    const std::string conflict_limit_opt = "--conflict-limit=";
+    const std::string time_limit_opt = "--time-limit=";
+    const std::string memory_limit_opt = "--memory-limit=";
+    const std::string stats_opt = "--stats=";
+    const std::string progress_opt = "--progress=";
+    const std::string check_opt = "--check=";
+    const std::string proof_opt = "--proof=";
+    const std::string binary_proof_opt = "--binary-proof=";
+    const std::string snapshot_opt = "--write-snapshot=";
+    if (arg.rfind(restart_opt, 0) == 0) {
+      auto restart = parse_restart(arg.substr(restart_opt.size()));
+      if (!restart) {
+        help();
+        std::exit(1);
+      }
+      options.restart = restart.value();
+    } else if (arg.rfind(branching_opt, 0) == 0) {
+      auto branching = parse_branching(arg.substr(branching_opt.size()));
+      if (!branching) {
+        help();
+        std::exit(1);
+      }
+      options.branching = branching.value();
+    } else if (arg.rfind(preprocess_opt, 0) == 0) {
+      auto preprocess = parse_bool(arg.substr(preprocess_opt.size()));
+      if (!preprocess) {
+        help();
+        std::exit(1);
+      }
+      options.preprocess = preprocess.value();
+    } else if (arg.rfind(inprocess_opt, 0) == 0) {
+      auto inprocess = parse_bool(arg.substr(inprocess_opt.size()));
+      if (!inprocess) {
+        help();
+        std::exit(1);
+      }
+      options.inprocess = inprocess.value();
+    } else if (arg.rfind(chrono_opt, 0) == 0) {
+      auto chrono = parse_bool(arg.substr(chrono_opt.size()));
+      if (!chrono) {
+        help();
+        std::exit(1);
+      }
+      options.chrono = chrono.value();
+    } else if (arg.rfind(walk_opt, 0) == 0) {
+      auto walk = parse_bool(arg.substr(walk_opt.size()));
+      if (!walk) {
+        help();
+        std::exit(1);
+      }
+      options.walk = walk.value();
+    } else if (arg.rfind(threads_opt, 0) == 0) {
+      auto n = parse_count(arg.substr(threads_opt.size()));
+      if (!n) {
+        help();
+        std::exit(1);
+      }
+      threads = n.value();
+    } else if (arg.rfind(cube_depth_opt, 0) == 0) {
+      auto depth = parse_count(arg.substr(cube_depth_opt.size()));
+      if (!depth) {
+        help();
+        std::exit(1);
+      }
+      cube_depth = depth.value();
+    } else if (arg.rfind(batch_opt, 0) == 0) {
+      batch = parse_batch(arg.substr(batch_opt.size()));
+      if (!batch) {
+        help();
+        std::exit(1);
+      }
+    } else if (arg.rfind(conflict_limit_opt, 0) == 0) {
+      auto n = parse_count(arg.substr(conflict_limit_opt.size()));
+      if (!n) {
+        help();
+        std::exit(1);
+      }
+      budget.conflicts = n.value();
+    } else if (arg.rfind(time_limit_opt, 0) == 0) {
+      auto seconds = parse_count(arg.substr(time_limit_opt.size()));
+      if (!seconds) {
+        help();
+        std::exit(1);
+      }
+      budget.seconds = static_cast<double>(seconds.value());
+    } else if (arg.rfind(memory_limit_opt, 0) == 0) {
+      auto mib = parse_count(arg.substr(memory_limit_opt.size()));
+      if (!mib || mib.value() > (std::numeric_limits<uint64_t>::max() >> 20)) {
+        help();
+        std::exit(1);
+      }
+      budget.memory_bytes = static_cast<uint64_t>(mib.value()) << 20;
+    } else if (arg.rfind(stats_opt, 0) == 0) {
+      auto yes = parse_bool(arg.substr(stats_opt.size()));
+      if (!yes) {
+        help();
+        std::exit(1);
+      }
+      print_stats = yes.value();
+    } else if (arg.rfind(progress_opt, 0) == 0) {
+      progress = parse_count(arg.substr(progress_opt.size()));
+      if (!progress) {
+        help();
+        std::exit(1);
+      }
+    } else if (arg.rfind(check_opt, 0) == 0) {
+      auto yes = parse_bool(arg.substr(check_opt.size()));
+      if (!yes) {
+        help();
+        std::exit(1);
+      }
+      check = yes.value();
+    } else if (arg.rfind(proof_opt, 0) == 0) {
+      proof_file = arg.substr(proof_opt.size());
+    } else if (arg.rfind(binary_proof_opt, 0) == 0) {
+      auto yes = parse_bool(arg.substr(binary_proof_opt.size()));
+      if (!yes) {
+        help();
+        std::exit(1);
+      }
+      binary_proof = yes.value();
+    } else if (arg.rfind(snapshot_opt, 0) == 0) {
+      snapshot_file = arg.substr(snapshot_opt.size());
+    } else if (arg.rfind("--", 0) == 0) {
+      help();
+      std::exit(1);
+    } else {
+      files.push_back(arg);
+    }
+  }
+  if (batch) {
+    if ((batch.value() == BatchInput::Args) == files.empty() || proof_file ||
+        progress || snapshot_file || cube_depth > 0) {
+      help();
+      std::exit(1);
+    }
+    std::ios::sync_with_stdio(false);
+    RunSettings run;
+    run.budget = budget;
+    run.check = check;
+    Batch pool(threads, options, run, print_stats, std::cout);
+    submit_batch(pool, batch.value(), files);
+    return pool.finish() ? 0 : 1;
+  }
+  if (!(files.size() == 1 || files.size() == 2) ||
+      ((proof_file || snapshot_file) && (threads > 1 || cube_depth > 0))) {
     help();
     std::exit(1);
   }
-  std::ifstream input(argv[1]);
-  auto cnf = bullsat::parse_cnf(input);
-  Solver solver;
-  if (cnf.var_num) {
-    solver = Solver(cnf.var_num.value());
+  auto input = InputStream::open(files[0]);
+  if (!input) {
+    std::cerr << "c cannot open " << files[0] << std::endl;
+    std::exit(1);
+  }
+  const auto start = std::chrono::steady_clock::now();
+  Status status;
+  std::vector<bool> assigns;
+  Stats stats;
+  bool model_ok = true;
+  if (threads > 1 || cube_depth > 0) {
+    // Parse once and share the clauses with every worker.
+    if (input->peek() == SNAPSHOT_MAGIC[0]) {
+      parse_error(files[0], "a snapshot needs a single solver");
+    }
+    CnfData cnf;
+    if (auto error = load_dimacs(*input, cnf)) {
+      parse_error(files[0], error.value());
+    }
+    input.reset();
+    if (cube_depth > 0) {
+      CubeAndConquer conquer(threads, cube_depth, options);
+      conquer.budget = budget;
+      status = conquer.solve(cnf);
+      assigns = std::move(conquer.assings);
+      stats = conquer.stats;
+    } else {
+      Portfolio portfolio(threads, options);
+      portfolio.budget = budget;
+      status = portfolio.solve(cnf);
+      assigns = std::move(portfolio.assings);
+      stats = portfolio.stats;
+    }
+    if (check && status == Status::Sat) {
+      model_ok = check_model(cnf, assigns);
+    }
+  } else {
+    RunSettings run;
+    run.budget = budget;
+    run.progress = progress;
+    run.check = check;
+    run.proof_file = proof_file;
+    run.binary_proof = binary_proof;
+    run.snapshot_file = snapshot_file;
+    run.start = start;
+    Outcome outcome = select_runner(options, proof_file.has_value())(
+        input, files[0], options, run);
+    status = outcome.status;
+    assigns = std::move(outcome.assigns);
+    stats = outcome.stats;
+    model_ok = outcome.model_ok;
+  }
+  if (!model_ok) {
+    std::cerr << "c model check failed" << std::endl;
+    std::exit(1);
+  }
+  if (print_stats) {
+    write_stats(stats, seconds_since(start), std::cout);
   }
-  auto clauses = cnf.clauses;
-  std::for_each(clauses.begin(), clauses.end(),
-                [&](const Clause &clause) { solver.add_clause(clause); });
-  Status status = solver.solve();
 
-  if (argc == 3) {
-    std::ofstream ofs(argv[2]);
-    write_result(solver, status, ofs, false);
+  if (files.size() == 2) {
+    std::ofstream ofs(files[1]);
+    write_result(assigns, status, ofs, false);
   } else {
-    write_result(solver, status, std::cout, true);
+    write_result(assigns, status, std::cout, true);
   }
 }
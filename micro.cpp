@@ -0,0 +1,352 @@
+#include "bullsat.hpp"
+#include "bench.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+using namespace bullsat;
+
+// Micro-benchmarks of the hot paths: propagate() on fixed trails,
+// analyze() per conflict, the variable heap and DIMACS parsing. Each
+// reports nanoseconds per operation and, where perf_event is available,
+// cache and branch misses per operation.
+
+void help() {
+  std::cout << "Usage: micro [options] <cnf-file|directory>..." << std::endl;
+  std::cout << "Options:" << std::endl;
+  std::cout << "  --min-ms=<n> (default: 200, the least time of a benchmark)"
+            << std::endl;
+}
+
+// Cache and branch misses of this thread in user space, counted through
+// perf_event_open(2) if the kernel allows it.
+class Counters {
+public:
+  static constexpr size_t EVENTS = 2;
+  Counters() {
+#ifdef __linux__
+    const uint64_t configs[EVENTS] = {PERF_COUNT_HW_CACHE_MISSES,
+                                      PERF_COUNT_HW_BRANCH_MISSES};
+    for (size_t i = 0; i < EVENTS; i++) {
+      perf_event_attr attr = {};
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.size = sizeof(attr);
+      attr.config = configs[i];
+      attr.disabled = 1;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      fds[i] = static_cast<int>(
+          syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0UL));
+    }
+#endif
+  }
+  Counters(const Counters &) = delete;
+  Counters &operator=(const Counters &) = delete;
+  ~Counters() {
+#ifdef __linux__
+    for (const int fd : fds) {
+      if (fd >= 0) {
+        close(fd);
+      }
+    }
+#endif
+  }
+  [[nodiscard]] bool available(size_t event) const { return fds[event] >= 0; }
+  void start() {
+#ifdef __linux__
+    for (const int fd : fds) {
+      if (fd >= 0) {
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+      }
+    }
+#endif
+  }
+  // Add the counts since start() to `totals`.
+  void stop(uint64_t (&totals)[EVENTS]) {
+#ifdef __linux__
+    for (size_t i = 0; i < EVENTS; i++) {
+      if (fds[i] < 0) {
+        continue;
+      }
+      ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+      uint64_t count = 0;
+      if (read(fds[i], &count, sizeof(count)) ==
+          static_cast<ssize_t>(sizeof(count))) {
+        totals[i] += count;
+      }
+    }
+#else
+    (void)totals;
+#endif
+  }
+
+private:
+  int fds[EVENTS] = {-1, -1};
+};
+
+// Time and counters summed over the measured sections of a benchmark.
+class Probe {
+public:
+  explicit Probe(Counters &hardware) : counters(hardware) {}
+  void begin() {
+    counters.start();
+    start = std::chrono::steady_clock::now();
+  }
+  void end(uint64_t operations) {
+    seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                             start)
+                   .count();
+    counters.stop(totals);
+    ops += operations;
+  }
+  [[nodiscard]] double elapsed() const { return seconds; }
+  // operations per second
+  [[nodiscard]] double rate() const {
+    return static_cast<double>(ops) / std::max(seconds, 1e-9);
+  }
+  void report(const std::string &name, const std::string &unit) const {
+    const double n = static_cast<double>(std::max<uint64_t>(ops, 1));
+    std::cout << "c " << std::left << std::setw(40) << name << std::right
+              << std::fixed << std::setprecision(2) << std::setw(10)
+              << seconds * 1e9 / n << " ns/" << unit;
+    const char *names[Counters::EVENTS] = {"cache misses", "branch misses"};
+    for (size_t i = 0; i < Counters::EVENTS; i++) {
+      if (counters.available(i)) {
+        std::cout << std::setw(10) << static_cast<double>(totals[i]) / n
+                  << " " << names[i] << "/" << unit;
+      }
+    }
+    std::cout << " (" << ops << " " << unit << "s)" << std::defaultfloat
+              << std::endl;
+  }
+
+private:
+  Counters &counters;
+  std::chrono::steady_clock::time_point start;
+  double seconds = 0;
+  uint64_t ops = 0;
+  uint64_t totals[Counters::EVENTS] = {};
+};
+
+// Decisions of a trail and whether it ends with a conflict
+struct Trail {
+  std::vector<Lit> decisions;
+  bool conflict = false;
+};
+
+// Decide random variables from `seed` until the first conflict.
+Trail record_trail(Solver &solver, uint64_t seed) {
+  std::mt19937_64 rng(seed);
+  std::vector<Var> order(solver.num_vars());
+  for (size_t v = 0; v < order.size(); v++) {
+    order[v] = Var(v);
+  }
+  std::shuffle(order.begin(), order.end(), rng);
+  Trail trail;
+  for (const Var v : order) {
+    if (solver.eval(Lit(v, true)) != LitBool::Undefine) {
+      continue;
+    }
+    const Lit lit = Lit(v, rng() % 2 == 0);
+    trail.decisions.push_back(lit);
+    solver.new_decision(lit);
+    if (solver.propagate()) {
+      trail.conflict = true;
+      break;
+    }
+  }
+  solver.pop_queue_until(0);
+  return trail;
+}
+
+// Make the decisions of `trail` again. Returns the conflict at its end.
+std::optional<CRef> replay(Solver &solver, const Trail &trail) {
+  for (const Lit lit : trail.decisions) {
+    if (solver.eval(lit) != LitBool::Undefine) {
+      continue;
+    }
+    solver.new_decision(lit);
+    if (std::optional<CRef> conflict = solver.propagate()) {
+      return conflict;
+    }
+  }
+  return std::nullopt;
+}
+
+void bench_search(const std::string &path, Counters &counters,
+                  double min_seconds) {
+  constexpr size_t TRAILS = 32;
+  auto input = InputStream::open(path);
+  Solver solver = Solver(0);
+  if (!input || load_dimacs(*input, solver) || solver.propagate()) {
+    std::cout << "c " << path << ": skipped" << std::endl;
+    return;
+  }
+  std::vector<Trail> trails;
+  for (uint64_t seed = 0; seed < TRAILS; seed++) {
+    trails.push_back(record_trail(solver, seed));
+  }
+  const std::string name = std::filesystem::path(path).stem().string();
+
+  Probe propagation(counters);
+  while (propagation.elapsed() < min_seconds) {
+    for (const Trail &trail : trails) {
+      const uint64_t before = solver.stats.propagations;
+      propagation.begin();
+      replay(solver, trail);
+      solver.pop_queue_until(0);
+      propagation.end(solver.stats.propagations - before);
+    }
+  }
+  propagation.report("propagate " + name, "propagation");
+
+  if (std::none_of(trails.begin(), trails.end(),
+                   [](const Trail &trail) { return trail.conflict; })) {
+    return;
+  }
+  Probe analysis(counters);
+  while (analysis.elapsed() < min_seconds) {
+    for (const Trail &trail : trails) {
+      if (const std::optional<CRef> conflict = replay(solver, trail)) {
+        analysis.begin();
+        const auto learnt = solver.analyze(conflict.value());
+        analysis.end(1);
+        (void)learnt;
+      }
+      solver.pop_queue_until(0);
+    }
+  }
+  analysis.report("analyze " + name, "conflict");
+}
+
+void bench_heap(size_t var_num, Counters &counters, double min_seconds) {
+  std::mt19937_64 rng(var_num);
+  std::uniform_real_distribution<double> activity(0.0, 1.0);
+  const std::string size = std::to_string(var_num);
+  Probe push(counters), update(counters), pop(counters);
+  while (push.elapsed() < min_seconds) {
+    Heap heap;
+    heap.grow(var_num);
+    for (double &act : heap.activity) {
+      act = activity(rng);
+    }
+    push.begin();
+    for (size_t v = 0; v < var_num; v++) {
+      heap.push(Var(v));
+    }
+    push.end(var_num);
+    // activity bumps as by EVSIDS
+    std::vector<Var> bumped(var_num);
+    for (Var &v : bumped) {
+      v = Var(rng() % var_num);
+    }
+    update.begin();
+    for (const Var v : bumped) {
+      heap.activity[static_cast<size_t>(v)] += 1.0;
+      heap.increase(v);
+    }
+    update.end(var_num);
+    pop.begin();
+    while (heap.pop()) {
+    }
+    pop.end(var_num);
+  }
+  push.report("heap push " + size, "op");
+  update.report("heap update " + size, "op");
+  pop.report("heap pop " + size, "op");
+}
+
+void bench_parse(const std::string &path, Counters &counters,
+                 double min_seconds) {
+  // decompressed once, so that only the parsing is timed
+  auto input = InputStream::open(path);
+  if (!input) {
+    std::cout << "c " << path << ": skipped" << std::endl;
+    return;
+  }
+  std::string text;
+  for (int c = input->peek(); c != EOF; c = input->peek()) {
+    text.push_back(static_cast<char>(c));
+    input->advance();
+  }
+  const std::string name = std::filesystem::path(path).stem().string();
+  Probe dimacs(counters), cnf(counters);
+  while (dimacs.elapsed() < min_seconds) {
+    CnfData data;
+    auto in = InputStream::from_memory(text.data(), text.size());
+    dimacs.begin();
+    const auto error = load_dimacs(*in, data);
+    dimacs.end(text.size());
+    if (error) {
+      std::cout << "c " << path << ": " << error.value() << std::endl;
+      return;
+    }
+  }
+  while (cnf.elapsed() < min_seconds) {
+    std::istringstream stream(text);
+    cnf.begin();
+    const CnfData data = parse_cnf(stream);
+    cnf.end(text.size());
+  }
+  dimacs.report("load_dimacs " + name, "byte");
+  cnf.report("parse_cnf " + name, "byte");
+  std::cout << "c " << name << ": " << std::fixed << std::setprecision(1)
+            << dimacs.rate() / 1e6 << " MB/s load_dimacs, "
+            << cnf.rate() / 1e6 << " MB/s parse_cnf" << std::defaultfloat
+            << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+  double min_seconds = 0.2;
+  std::vector<std::string> paths;
+  for (int i = 1; i < argc; i++) {
+    const std::string arg = argv[i];
+    const std::string min_ms_opt = "--min-ms=";
+    if (arg.rfind(min_ms_opt, 0) == 0) {
+      auto ms = parse_count(arg.substr(min_ms_opt.size()));
+      if (!ms) {
+        help();
+        std::exit(1);
+      }
+      min_seconds = static_cast<double>(ms.value()) / 1000.0;
+    } else if (arg.rfind("--", 0) == 0) {
+      help();
+      std::exit(1);
+    } else {
+      paths.push_back(arg);
+    }
+  }
+  const std::vector<std::string> instances = collect_instances(paths);
+  if (instances.empty()) {
+    help();
+    std::exit(1);
+  }
+  Counters counters;
+  if (!counters.available(0)) {
+    std::cout << "c no hardware counters (perf_event_open failed)"
+              << std::endl;
+  }
+  for (const std::string &path : instances) {
+    bench_search(path, counters, min_seconds);
+  }
+  for (const size_t var_num : {size_t(1000), size_t(100000), size_t(1000000)}) {
+    bench_heap(var_num, counters, min_seconds);
+  }
+  for (const std::string &path : instances) {
+    bench_parse(path, counters, min_seconds);
+  }
+}
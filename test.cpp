@@ -3,6 +3,7 @@
 #include <cassert>
 #include <fstream>
 #include <iostream>
+#include <random>
 #include <sstream>
 
 using namespace std;
@@ -37,6 +38,51 @@ void test_lit() {
   assert(!x1.neg());
 }
 
+void test_find_value() {
+  test_start(__func__);
+  const size_t var_num = 40;
+  std::mt19937 rng(4);
+  std::vector<LitBool> values(2 * var_num + VALUE_PADDING, LitBool::Undefine);
+  for (size_t v = 0; v < var_num; v++) {
+    const size_t r = rng() % 3;
+    if (r < 2) {
+      values[2 * v + r] = LitBool::True;
+      values[2 * v + 1 - r] = LitBool::False;
+    }
+  }
+  for (int round = 0; round < 200; round++) {
+    Clause clause(rng() % 30);
+    for (Lit &lit : clause) {
+      lit = Lit(Var(rng() % var_num), rng() % 2 == 0);
+    }
+    for (const LitBool value :
+         {LitBool::True, LitBool::False, LitBool::Undefine}) {
+      size_t equal = 0;
+      while (equal < clause.size() && values[clause[equal].lidx()] != value) {
+        equal++;
+      }
+      size_t differ = 0;
+      while (differ < clause.size() && values[clause[differ].lidx()] == value) {
+        differ++;
+      }
+      assert(find_value<true>(clause.data(), clause.size(), values.data(),
+                              value) == equal);
+      assert(find_value<false>(clause.data(), clause.size(), values.data(),
+                               value) == differ);
+    }
+  }
+  // The last literal only has the padding after it.
+  const Clause last{Lit(Var(var_num - 1), false)};
+  assert(find_value<true>(last.data(), 1, values.data(),
+                          values[last[0].lidx()]) == 0);
+  // Variables beyond a model are false.
+  const std::vector<LitBool> model = model_values({true, false}, 3);
+  assert(model.size() == 6 + VALUE_PADDING);
+  assert(model[0] == LitBool::True && model[1] == LitBool::False);
+  assert(model[2] == LitBool::False && model[3] == LitBool::True);
+  assert(model[4] == LitBool::False && model[5] == LitBool::False);
+}
+
 void test_enqueue_and_eval() {
   test_start(__func__);
   {
@@ -83,7 +129,8 @@ void test_propagate() {
 
     auto confl = solver.propagate();
     assert(confl.has_value());
-    Clause &clause = *confl.value();
+    ArenaClause conflict = solver.clause_at(confl.value());
+    Clause clause = Clause(conflict.begin(), conflict.end());
     std::sort(clause.begin(), clause.end());
     assert(clause[0] == Lit(0, false));
     assert(clause[1] == Lit(1, false));
@@ -119,6 +166,34 @@ void test_propagate() {
   }
 }
 
+void test_propagate_binary() {
+  test_start(__func__);
+  {
+    // x0 -> x1 -> x2 through binary clauses
+    Solver solver = Solver(4);
+    solver.add_clause(Clause{Lit(0, false), Lit(1, true)});
+    solver.add_clause(Clause{Lit(1, false), Lit(2, true)});
+    // (!x0 v !x2 v x3)
+    solver.add_clause(Clause{Lit(0, false), Lit(2, false), Lit(3, true)});
+    solver.new_decision(Lit(0, true));
+    auto confl = solver.propagate();
+    assert(!confl.has_value());
+    assert(solver.eval(Lit(1, true)) == LitBool::True);
+    assert(solver.eval(Lit(2, true)) == LitBool::True);
+    assert(solver.eval(Lit(3, true)) == LitBool::True);
+  }
+  {
+    // A blocker doesn't hide a conflict.
+    Solver solver = Solver(3);
+    solver.add_clause(Clause{Lit(0, false), Lit(1, true), Lit(2, true)});
+    solver.add_clause(Clause{Lit(0, false), Lit(1, true), Lit(2, false)});
+    solver.new_decision(Lit(0, true));
+    solver.new_decision(Lit(1, false));
+    auto confl = solver.propagate();
+    assert(confl.has_value());
+  }
+}
+
 void test_analyze() {
   test_start(__func__);
   {
@@ -168,14 +243,72 @@ void test_analyze() {
     solver.new_decision(Lit(0, true));
     auto confl = solver.propagate();
 
-    auto [learnt_clause, level] = solver.analyze(confl.value());
+    auto [learnt_clause, level, lbd] = solver.analyze(confl.value());
     assert(learnt_clause.size() == 3 && level == 2);
-    // (!x1 v !x5 v !x6)
-    Clause l = Clause{Lit(1, false), Lit(5, false), Lit(6, false)};
+    // x1@3, x5@1, x6@2
+    assert(lbd == 3);
+    // (!x1 v !x6 v !x5)
+    // The second literal has the back jump level.
+    Clause l = Clause{Lit(1, false), Lit(6, false), Lit(5, false)};
     assert(learnt_clause == l);
   }
 }
 
+void test_minimize() {
+  test_start(__func__);
+  // @1: x0 x1
+  // @2: x2 x3 x4
+  // 1-UIP: (!x3 v !x0 v !x1) and x1 is implied by x0.
+  for (const bool minimize : {false, true}) {
+    SolverOptions options;
+    options.minimize = minimize;
+    Solver solver = Solver(5, options);
+    solver.add_clause(Clause{Lit(0, false), Lit(1, true)});
+    solver.add_clause(Clause{Lit(2, false), Lit(3, true)});
+    solver.add_clause(Clause{Lit(3, false), Lit(1, false), Lit(4, true)});
+    solver.add_clause(Clause{Lit(3, false), Lit(0, false), Lit(4, false)});
+    solver.new_decision(Lit(0, true));
+    assert(!solver.propagate().has_value());
+    solver.new_decision(Lit(2, true));
+    auto confl = solver.propagate();
+    assert(confl.has_value());
+
+    auto [learnt_clause, level, lbd] = solver.analyze(confl.value());
+    assert(level == 1 && lbd == 2);
+    assert(learnt_clause[0] == Lit(3, false));
+    if (minimize) {
+      assert((learnt_clause == Clause{Lit(3, false), Lit(0, false)}));
+    } else {
+      assert(learnt_clause.size() == 3);
+    }
+  }
+  // @1: x0
+  // @2: x3 x4
+  // 1-UIP: (!x3 v !x0) and a binary clause (!x3 v x0) removes !x0.
+  for (const bool binary_minimize : {false, true}) {
+    SolverOptions options;
+    options.binary_minimize = binary_minimize;
+    Solver solver = Solver(5, options);
+    solver.add_clause(Clause{Lit(3, false), Lit(0, true)});
+    solver.add_clause(Clause{Lit(3, false), Lit(0, false), Lit(4, true)});
+    solver.add_clause(Clause{Lit(3, false), Lit(0, false), Lit(4, false)});
+    solver.new_decision(Lit(0, true));
+    assert(!solver.propagate().has_value());
+    solver.new_decision(Lit(3, true));
+    auto confl = solver.propagate();
+    assert(confl.has_value());
+
+    auto [learnt_clause, level, lbd] = solver.analyze(confl.value());
+    if (binary_minimize) {
+      assert((learnt_clause == Clause{Lit(3, false)}));
+      assert(level == 0 && lbd == 1);
+    } else {
+      assert((learnt_clause == Clause{Lit(3, false), Lit(0, false)}));
+      assert(level == 1 && lbd == 2);
+    }
+  }
+}
+
 void test_queue() {
   test_start(__func__);
   Solver solver = Solver(10);
@@ -204,11 +337,12 @@ void test_queue() {
   assert(solver.eval(Lit(3, true)) == LitBool::Undefine);
 }
 
+// Eliminated variables are assigned only in the model.
 bool validate_satisfiable(const vector<Clause> &clauses, const Solver &solver) {
   for (const auto &clause : clauses) {
     bool satisfied = false;
     for (const auto &lit : clause) {
-      if (solver.eval(lit) == LitBool::True) {
+      if (solver.assings[lit.vidx()] == lit.pos()) {
         satisfied = true;
         break;
       }
@@ -251,6 +385,57 @@ void test_solve() {
   }
 }
 
+void test_preprocess() {
+  test_start(__func__);
+  {
+    // x0 fails: (!x0 v x1) and (!x0 v x2) and (!x1 v !x2 v x3) and
+    // (!x3 v !x0) and (x0 v x4 v x5)
+    SolverOptions options;
+    Solver solver = Solver(6, options);
+    vector<Clause> clauses = {
+        Clause{Lit(0, false), Lit(1, true)},
+        Clause{Lit(0, false), Lit(2, true)},
+        Clause{Lit(1, false), Lit(2, false), Lit(3, true)},
+        Clause{Lit(3, false), Lit(0, false)},
+        Clause{Lit(0, true), Lit(4, true), Lit(5, true)}};
+    for (const Clause &clause : clauses) {
+      solver.add_clause(clause);
+    }
+    assert(solver.preprocess());
+    assert(solver.stats.failed_literals >= 1);
+    assert(solver.eval(Lit(0, false)) == LitBool::True);
+    assert(solver.stats.eliminated > 0);
+    assert(solver.solve() == Status::Sat);
+    assert(validate_satisfiable(clauses, solver));
+  }
+  {
+    // random 3-SAT around the threshold with and without preprocessing
+    std::mt19937 rng(1);
+    for (int round = 0; round < 300; round++) {
+      vector<Clause> clauses;
+      for (int i = 0; i < 52; i++) {
+        Clause clause;
+        for (int j = 0; j < 3; j++) {
+          clause.push_back(Lit(Var(rng() % 12), rng() % 2 == 0));
+        }
+        clauses.push_back(clause);
+      }
+      SolverOptions options;
+      options.preprocess = false;
+      Solver plain = Solver(12, options);
+      Solver simplified = Solver(12);
+      for (const Clause &clause : clauses) {
+        plain.add_clause(clause);
+        simplified.add_clause(clause);
+      }
+      const Status status = plain.solve();
+      assert(simplified.solve() == status);
+      if (status == Status::Sat) {
+        assert(validate_satisfiable(clauses, simplified));
+      }
+    }
+  }
+}
 void test_parse_cnf() {
   test_start(__func__);
 
@@ -275,6 +460,505 @@ void test_parse_cnf() {
   assert(data.clauses == clauses);
 }
 
+void test_parse_dimacs() {
+  test_start(__func__);
+  {
+    // mmap-ed
+    auto in = InputStream::open("./cnf/sat.cnf");
+    assert(in);
+    Solver solver = Solver();
+    assert(!load_dimacs(*in, solver).has_value());
+    assert(solver.num_vars() == 3);
+    assert(solver.solve() == Status::Sat);
+  }
+  {
+    const std::string text = "p cnf 2 2\n1 2 0\n-1 0\n";
+    auto in = InputStream::from_memory(text.data(), text.size());
+    Solver solver = Solver();
+    assert(!load_dimacs(*in, solver).has_value());
+    assert(solver.solve() == Status::Sat);
+    assert((solver.assings == vector<bool>{false, true}));
+  }
+  {
+    // A clause over lines, tabs and SATLIB's trailer
+    std::istringstream stream("c comment\np cnf 4  2\n1 -2\t\n 3 0\n"
+                              "-4 0\n%\n0\n");
+    InputStream in(std::make_unique<IstreamSource>(stream));
+    vector<Clause> clauses;
+    size_t var_num = 0;
+    auto error = parse_dimacs(
+        in, [&](size_t vars, size_t) { var_num = vars; },
+        [&](const Clause &clause) { clauses.push_back(clause); });
+    assert(!error.has_value());
+    assert(var_num == 4);
+    assert((clauses == vector<Clause>{
+                           Clause{Lit(0, true), Lit(1, false), Lit(2, true)},
+                           Clause{Lit(3, false)}}));
+  }
+  {
+    std::istringstream stream("p cnf 2 1\n1 x 0\n");
+    InputStream in(std::make_unique<IstreamSource>(stream));
+    auto error = parse_dimacs(
+        in, [](size_t, size_t) {}, [](const Clause &) {});
+    assert(error.has_value() && error.value().rfind("line 2", 0) == 0);
+  }
+}
+
+void test_parse_compressed() {
+  test_start(__func__);
+  const std::string cnf = "p cnf 3 2\n1 -2 0\n2 3 0\n";
+  const vector<Clause> expected = {Clause{Lit(0, true), Lit(1, false)},
+                                   Clause{Lit(1, true), Lit(2, true)}};
+  auto parse = [](std::unique_ptr<Source> source, vector<Clause> &clauses) {
+    InputStream in(std::move(source));
+    return parse_dimacs(
+        in, [](size_t, size_t) {},
+        [&](const Clause &clause) { clauses.push_back(clause); });
+  };
+  assert(detect_compression(cnf.data(), cnf.size()) == Compression::None);
+#ifdef BULLSAT_ZLIB
+  {
+    // gzip -c a b > c concatenates members
+    auto gzip = [](const std::string &text) {
+      z_stream zs = {};
+      deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+                   Z_DEFAULT_STRATEGY);
+      std::string out(deflateBound(&zs, static_cast<uLong>(text.size())), 0);
+      zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(text.data()));
+      zs.avail_in = static_cast<uInt>(text.size());
+      zs.next_out = reinterpret_cast<Bytef *>(out.data());
+      zs.avail_out = static_cast<uInt>(out.size());
+      deflate(&zs, Z_FINISH);
+      out.resize(zs.total_out);
+      deflateEnd(&zs);
+      return out;
+    };
+    const std::string data = gzip(cnf.substr(0, 12)) + gzip(cnf.substr(12));
+    assert(detect_compression(data.data(), data.size()) == Compression::Gzip);
+    vector<Clause> clauses;
+    auto error =
+        parse(std::make_unique<GzipSource>(
+                  std::make_unique<MemorySource>(data.data(), data.size())),
+              clauses);
+    assert(!error.has_value());
+    assert(clauses == expected);
+
+    clauses.clear();
+    // truncated
+    error = parse(
+        std::make_unique<GzipSource>(
+            std::make_unique<MemorySource>(data.data(), data.size() - 4)),
+        clauses);
+    assert(error.has_value());
+  }
+#endif
+#ifdef BULLSAT_LZMA
+  {
+    std::string data(lzma_stream_buffer_bound(cnf.size()), 0);
+    size_t size = 0;
+    lzma_easy_buffer_encode(
+        LZMA_PRESET_DEFAULT, LZMA_CHECK_CRC64, nullptr,
+        reinterpret_cast<const uint8_t *>(cnf.data()), cnf.size(),
+        reinterpret_cast<uint8_t *>(data.data()), &size, data.size());
+    data.resize(size);
+    assert(detect_compression(data.data(), data.size()) == Compression::Xz);
+    vector<Clause> clauses;
+    auto error =
+        parse(std::make_unique<XzSource>(
+                  std::make_unique<MemorySource>(data.data(), data.size())),
+              clauses);
+    assert(!error.has_value());
+    assert(clauses == expected);
+
+    clauses.clear();
+    // truncated
+    error = parse(
+        std::make_unique<XzSource>(
+            std::make_unique<MemorySource>(data.data(), data.size() / 2)),
+        clauses);
+    assert(error.has_value());
+  }
+#endif
+}
+
+void test_clause_exchange() {
+  test_start(__func__);
+  ClauseExchange exchange(2);
+  std::vector<uint64_t> cursors;
+  Clause buf;
+  vector<Clause> received;
+  auto collect = [&](size_t worker) {
+    received.clear();
+    exchange.collect(worker, cursors, buf, [&](const Clause &clause,
+                                               uint32_t) {
+      received.push_back(clause);
+    });
+  };
+  const Clause clause = {Lit(0, true), Lit(1, false)};
+  exchange.publish(0, clause, 2);
+  // A worker doesn't read its own clauses.
+  collect(0);
+  assert(received.empty());
+  cursors.clear();
+  collect(1);
+  assert(received == vector<Clause>{clause});
+  collect(1);
+  assert(received.empty());
+
+  // A slow reader keeps the latest CAPACITY clauses.
+  for (size_t i = 0; i < ClauseExchange::CAPACITY + 5; i++) {
+    exchange.publish(0, Clause{Lit(Var(i), true)}, 1);
+  }
+  collect(1);
+  assert(received.size() == ClauseExchange::CAPACITY);
+  assert(received[0] == Clause{Lit(5, true)});
+}
+
+void test_portfolio() {
+  test_start(__func__);
+  {
+    // An interrupted solver can continue.
+    Solver solver = Solver(2);
+    solver.add_clause(Clause{Lit(0, true), Lit(1, true)});
+    solver.interrupt();
+    assert(solver.solve() == Status::Unknown);
+    assert(solver.solve() == Status::Sat);
+  }
+  for (const char *path : {"./cnf/sat.cnf", "./cnf/unsat.cnf"}) {
+    auto in = InputStream::open(path);
+    assert(in);
+    CnfData cnf;
+    assert(!load_dimacs(*in, cnf).has_value());
+    Portfolio portfolio(3, SolverOptions());
+    const Status status = portfolio.solve(cnf);
+    assert(portfolio.winner.has_value());
+    if (std::string(path) == "./cnf/sat.cnf") {
+      assert(status == Status::Sat);
+      for (const Clause &clause : cnf.clauses) {
+        assert(std::any_of(clause.begin(), clause.end(), [&](Lit lit) {
+          return portfolio.assings[lit.vidx()] == lit.pos();
+        }));
+      }
+    } else {
+      assert(status == Status::Unsat);
+    }
+  }
+}
+
+void test_incremental() {
+  test_start(__func__);
+  {
+    // (!x0 v x1) and (!x1 v x2): {x0, x3, !x2} fails on {x0, !x2}.
+    SolverOptions options;
+    options.preprocess = false;
+    Solver solver = Solver(4, options);
+    solver.add_clause(Clause{Lit(0, false), Lit(1, true)});
+    solver.add_clause(Clause{Lit(1, false), Lit(2, true)});
+    assert(solver.solve({Lit(0, true), Lit(3, true), Lit(2, false)}) ==
+           Status::Unsat);
+    vector<Lit> failed = solver.failed_assumptions;
+    sort(failed.begin(), failed.end());
+    assert((failed == vector<Lit>{Lit(0, true), Lit(2, false)}));
+    // Clauses can be added after Sat.
+    assert(solver.solve({Lit(0, true)}) == Status::Sat);
+    solver.add_clause(Clause{Lit(2, false)});
+    assert(solver.solve({Lit(0, true)}) == Status::Unsat);
+    assert(solver.failed_assumptions == vector<Lit>{Lit(0, true)});
+    assert(solver.solve() == Status::Sat);
+    assert(solver.assings[0] == false);
+    solver.add_clause(Clause{Lit(0, true)});
+    assert(solver.solve() == Status::Unsat);
+    assert(solver.failed_assumptions.empty());
+  }
+  {
+    // x1 is eliminated from (x0 v x1) and (!x1 v x2).
+    Solver solver = Solver(3);
+    solver.add_clause(Clause{Lit(0, true), Lit(1, true)});
+    solver.add_clause(Clause{Lit(1, false), Lit(2, true)});
+    assert(solver.solve() == Status::Sat);
+    assert(solver.stats.eliminated > 0);
+    assert(solver.solve({Lit(1, true), Lit(2, false)}) == Status::Unsat);
+    solver.add_clause(Clause{Lit(0, false)});
+    solver.add_clause(Clause{Lit(1, false), Lit(2, false)});
+    assert(solver.solve() == Status::Unsat);
+  }
+  {
+    // Incremental answers agree with fresh solvers.
+    std::mt19937 rng(3);
+    Solver solver = Solver(20);
+    vector<Clause> clauses;
+    for (int round = 0; round < 60; round++) {
+      for (int i = 0; i < 2; i++) {
+        Clause clause;
+        for (int j = 0; j < 3; j++) {
+          clause.push_back(Lit(Var(rng() % 20), rng() % 2 == 0));
+        }
+        clauses.push_back(clause);
+        solver.add_clause(clause);
+      }
+      vector<Lit> assumptions;
+      for (int j = 0; j < 3; j++) {
+        assumptions.push_back(Lit(Var(rng() % 20), rng() % 2 == 0));
+      }
+      Solver fresh = Solver(20);
+      for (const Clause &clause : clauses) {
+        fresh.add_clause(clause);
+      }
+      for (const Lit lit : assumptions) {
+        fresh.add_clause(Clause{lit});
+      }
+      const Status status = solver.solve(assumptions);
+      assert(status == fresh.solve());
+      if (status == Status::Sat) {
+        assert(validate_satisfiable(clauses, solver));
+        for (const Lit lit : assumptions) {
+          assert(solver.assings[lit.vidx()] == lit.pos());
+        }
+      } else if (solver.status != Status::Unsat) {
+        // The failed assumptions alone are Unsat.
+        Solver core = Solver(20);
+        for (const Clause &clause : clauses) {
+          core.add_clause(clause);
+        }
+        for (const Lit lit : solver.failed_assumptions) {
+          assert(std::find(assumptions.begin(), assumptions.end(), lit) !=
+                 assumptions.end());
+          core.add_clause(Clause{lit});
+        }
+        assert(core.solve() == Status::Unsat);
+      }
+    }
+  }
+}
+
+// holes + 1 pigeons don't fit in `holes` holes.
+template <typename S> void add_pigeonhole(S &solver, int holes) {
+  auto var = [&](int pigeon, int hole) { return Var(pigeon * holes + hole); };
+  for (int p = 0; p <= holes; p++) {
+    Clause clause;
+    for (int h = 0; h < holes; h++) {
+      clause.push_back(Lit(var(p, h), true));
+    }
+    solver.add_clause(clause);
+  }
+  for (int h = 0; h < holes; h++) {
+    for (int p = 0; p <= holes; p++) {
+      for (int q = p + 1; q <= holes; q++) {
+        solver.add_clause(Clause{Lit(var(p, h), false), Lit(var(q, h), false)});
+      }
+    }
+  }
+}
+
+// `clause_num` clauses of 3 random literals over `var_num` variables
+vector<Clause> random_3sat(std::mt19937 &rng, size_t var_num,
+                           size_t clause_num) {
+  vector<Clause> clauses;
+  for (size_t i = 0; i < clause_num; i++) {
+    Clause clause;
+    for (size_t j = 0; j < 3; j++) {
+      clause.push_back(Lit(Var(rng() % var_num), rng() % 2 == 0));
+    }
+    clauses.push_back(clause);
+  }
+  return clauses;
+}
+template <typename S>
+void add_random_3sat(S &solver, std::mt19937 &rng, size_t var_num,
+                     size_t clause_num) {
+  for (const Clause &clause : random_3sat(rng, var_num, clause_num)) {
+    solver.add_clause(clause);
+  }
+}
+
+void test_budget() {
+  test_start(__func__);
+  auto pigeonhole = [](Solver &solver) { add_pigeonhole(solver, 6); };
+  {
+    // The search goes on in slices of 10 conflicts.
+    Solver solver = Solver(0);
+    pigeonhole(solver);
+    Budget budget;
+    budget.conflicts = 10;
+    size_t slices = 0;
+    while (true) {
+      const uint64_t conflicts = solver.stats.conflicts;
+      solver.set_budget(budget);
+      const Status status = solver.solve();
+      assert(solver.stats.conflicts - conflicts <= 10);
+      slices++;
+      if (status != Status::Unknown) {
+        assert(status == Status::Unsat);
+        break;
+      }
+    }
+    assert(slices > 1);
+  }
+  {
+    Solver solver = Solver(0);
+    pigeonhole(solver);
+    Budget budget;
+    budget.decisions = 0;
+    solver.set_budget(budget);
+    assert(solver.solve() == Status::Unknown);
+    assert(solver.stats.decisions == 0);
+    budget = Budget();
+    budget.seconds = 0;
+    solver.set_budget(budget);
+    assert(solver.solve() == Status::Unknown);
+    budget.seconds = 60;
+    solver.set_budget(budget);
+    size_t reports = 0;
+    solver.set_progress(0, [&](const Stats &stats) {
+      assert(stats.conflicts == solver.stats.conflicts);
+      reports++;
+    });
+    assert(solver.solve() == Status::Unsat);
+    assert(reports > 0);
+    const Stats &stats = solver.stats;
+    assert(stats.learnts_added > 0 && stats.lbd_sum > 0);
+    assert(stats.learnts_deleted <= stats.learnts_added);
+    assert(stats.average_lbd() >= 1.0);
+  }
+}
+
+void test_output_buffer() {
+  test_start(__func__);
+  OutputBuffer out;
+  out.append("v");
+  out.append(' ');
+  out.append_lit(Lit(0, false));
+  out.append(' ');
+  out.append_lit(Lit(41, true));
+  out.append(' ');
+  out.append_int(std::numeric_limits<int64_t>::min());
+  out.append('\n');
+  std::ostringstream os;
+  out.write_to(os);
+  assert(os.str() == "v -1 42 -9223372036854775808\n");
+  assert(out.empty());
+  std::string other = "x";
+  out.swap(other);
+  assert(out.size() == 1 && other.empty());
+}
+
+void test_proof() {
+  test_start(__func__);
+  {
+    const Clause clause = {Lit(0, true), Lit(1, false)};
+    std::ostringstream text, binary;
+    {
+      ProofWriter writer(text, false);
+      writer.add(clause.begin(), clause.end());
+      writer.remove(clause.begin(), clause.end());
+    }
+    assert(text.str() == "1 -2 0\nd 1 -2 0\n");
+    {
+      ProofWriter writer(binary, true);
+      const Clause large = {Lit(99, true)};
+      writer.add(large.begin(), large.end());
+      writer.remove(clause.begin(), clause.end());
+    }
+    // 200 = 0b1'1001000
+    assert(binary.str() == std::string("a\xc8\x01\0d\x02\x05\0", 8));
+  }
+  {
+    // x0 v x1, x0 v !x1, !x0 v x1, !x0 v !x1
+    std::ostringstream os;
+    Solver solver = Solver(2);
+    ProofWriter writer(os, false);
+    solver.write_proof(writer);
+    for (const bool a : {true, false}) {
+      for (const bool b : {true, false}) {
+        solver.add_clause(Clause{Lit(0, a), Lit(1, b)});
+      }
+    }
+    assert(solver.solve() == Status::Unsat);
+    const std::string proof = os.str();
+    assert(proof.size() >= 2 && proof.substr(proof.size() - 2) == "0\n");
+    assert(proof.size() == 2 || proof[proof.size() - 3] == '\n');
+  }
+  {
+    SolverOptions options;
+    options.keep_input_clauses = true;
+    Solver solver = Solver(3, options);
+    CnfData cnf;
+    cnf.clauses = {Clause{Lit(0, true), Lit(1, true)},
+                   Clause{Lit(1, false), Lit(2, true)}};
+    for (const Clause &clause : cnf.clauses) {
+      solver.add_clause(clause);
+    }
+    assert(solver.solve() == Status::Sat);
+    assert(solver.check_model());
+    assert(check_model(cnf, solver.assings));
+    solver.assings = {false, false, false};
+    assert(!solver.check_model());
+    assert(!check_model(cnf, solver.assings));
+  }
+}
+
+void test_cube_and_conquer() {
+  test_start(__func__);
+  {
+    // (x0 v x1) is Unsat under {!x0, !x1} but stays satisfiable.
+    Solver solver = Solver(2);
+    solver.add_clause(Clause{Lit(0, true), Lit(1, true)});
+    assert(solver.solve({Lit(0, false), Lit(1, false)}) == Status::Unsat);
+    assert(solver.status != Status::Unsat);
+    assert(solver.solve({Lit(0, false)}) == Status::Sat);
+    assert(solver.assings[0] == false && solver.assings[1] == true);
+    assert(solver.solve() == Status::Sat);
+  }
+  {
+    // random 3-SAT: some cube contains a model iff the formula is Sat
+    std::mt19937 rng(2);
+    for (int round = 0; round < 50; round++) {
+      CnfData cnf;
+      cnf.var_num = 16;
+      for (int i = 0; i < 68; i++) {
+        Clause clause;
+        for (int j = 0; j < 3; j++) {
+          clause.push_back(Lit(Var(rng() % 16), rng() % 2 == 0));
+        }
+        cnf.clauses.push_back(clause);
+      }
+      Solver solver = Solver(16);
+      for (const Clause &clause : cnf.clauses) {
+        solver.add_clause(clause);
+      }
+      const Status status = solver.solve();
+      const auto cubes = CubeGenerator(cnf, 3).generate();
+      assert(cubes.size() <= 8);
+      size_t sat_cubes = 0;
+      for (const auto &cube : cubes) {
+        if (solver.solve(cube) == Status::Sat) {
+          sat_cubes++;
+        }
+      }
+      assert((sat_cubes > 0) == (status == Status::Sat));
+      CubeAndConquer conquer(2, 3, SolverOptions());
+      assert(conquer.solve(cnf) == status);
+      if (status == Status::Sat) {
+        for (const Clause &clause : cnf.clauses) {
+          assert(std::any_of(clause.begin(), clause.end(), [&](Lit lit) {
+            return conquer.assings[lit.vidx()] == lit.pos();
+          }));
+        }
+      }
+    }
+  }
+  for (const char *path : {"./cnf/sat.cnf", "./cnf/unsat.cnf"}) {
+    auto in = InputStream::open(path);
+    assert(in);
+    CnfData cnf;
+    assert(!load_dimacs(*in, cnf).has_value());
+    CubeAndConquer conquer(3, 2, SolverOptions());
+    const Status status = conquer.solve(cnf);
+    assert(status == (std::string(path) == "./cnf/sat.cnf" ? Status::Sat
+                                                           : Status::Unsat));
+  }
+}
+
 void test_heap() {
   test_start(__func__);
 
@@ -294,16 +978,565 @@ void test_heap() {
       assert(hvar == var);
     }
   }
+  {
+    // any arity and a linear-time build pop in activity order
+    DaryHeap<2> binary;
+    Heap built;
+    std::vector<Var> vars;
+    for (size_t i = 0; i < 100; i++) {
+      const double act = static_cast<double>((i * 37) % 101);
+      binary.push(Var(i));
+      binary.activity[i] = act;
+      binary.update(Var(i));
+      built.grow(i + 1);
+      built.activity[i] = act;
+      if (i % 3 != 0) {
+        vars.push_back(Var(i));
+      }
+    }
+    built.push(Var(0));
+    built.build(vars);
+    assert(!built.in_heap(Var(0)) && built.size() == vars.size());
+    double prev = 1e9;
+    while (std::optional<Var> v = built.pop()) {
+      assert(static_cast<size_t>(*v) % 3 != 0);
+      assert(built.activity[static_cast<size_t>(*v)] <= prev);
+      prev = built.activity[static_cast<size_t>(*v)];
+    }
+    prev = 1e9;
+    while (std::optional<Var> v = binary.pop()) {
+      assert(binary.activity[static_cast<size_t>(*v)] <= prev);
+      prev = binary.activity[static_cast<size_t>(*v)];
+    }
+  }
+}
+
+void test_branching() {
+  test_start(__func__);
+  auto unassigned = [](Var) { return false; };
+  {
+    Evsids evsids = Evsids(0.95);
+    for (Var v = 0; v < 4; v++) {
+      evsids.new_var(v);
+    }
+    evsids.bump(2);
+    evsids.decay();
+    evsids.bump(1);
+    evsids.bump(1);
+    assert(evsids.pick(unassigned) == 1);
+    assert(evsids.pick(unassigned) == 2);
+    // skip assigned variables
+    assert(evsids.pick([](Var v) { return v == 0; }) == 3);
+    evsids.on_unassign(1);
+    assert(evsids.pick(unassigned) == 1);
+  }
+  {
+    Vmtf vmtf = Vmtf();
+    for (Var v = 0; v < 4; v++) {
+      vmtf.new_var(v);
+    }
+    // the last enqueued variable first
+    assert(vmtf.pick(unassigned) == 3);
+    // 0 and 1 are in a conflict (assigned) and unassigned by backtrack.
+    vector<Var> bumped = {0, 1};
+    vmtf.bump_all(bumped);
+    vmtf.on_unassign(0);
+    vmtf.on_unassign(1);
+    // 2 3 0 1
+    assert(vmtf.last == 1 && vmtf.first == 2);
+    assert(vmtf.pick(unassigned) == 1);
+    assert(vmtf.pick([](Var v) { return v == 1 || v == 0; }) == 3);
+    // 0 is unassigned again and more recent than 3.
+    vmtf.on_unassign(0);
+    assert(vmtf.pick(unassigned) == 0);
+  }
+}
+
+void test_phases() {
+  test_start(__func__);
+  SolverOptions options;
+  options.target_phase = true;
+  Phases phases = Phases(options);
+  for (size_t i = 0; i < 4; i++) {
+    phases.new_var();
+  }
+  // initial phase
+  assert(phases.decide(0, false) == Lit(0, false));
+  // saved phase
+  phases.save(Lit(0, true));
+  assert(phases.decide(0, false) == Lit(0, true));
+
+  // target/best phase
+  vector<Lit> trail = {Lit(1, true), Lit(2, true), Lit(3, false)};
+  phases.update(trail, 2);
+  assert(phases.decide(1, true) == Lit(1, true));
+  assert(phases.decide(1, false) == Lit(1, false));
+  assert(phases.decide(3, true) == Lit(3, false));
+
+  // Original, Best, Inverted
+  assert(phases.rephase(0) == Rephase::Original);
+  assert(phases.decide(0, false) == Lit(0, false));
+  // target is reset
+  assert(phases.decide(1, true) == Lit(1, false));
+  assert(phases.rephase(0) == Rephase::Best);
+  assert(phases.decide(1, false) == Lit(1, true));
+  assert(phases.decide(2, false) == Lit(2, true));
+  assert(phases.rephase(0) == Rephase::Inverted);
+  assert(phases.decide(3, false) == Lit(3, true));
+}
+
+void test_clause_arena() {
+  test_start(__func__);
+
+  ClauseArena ca;
+  Clause c0 = Clause{Lit(0, true), Lit(1, false)};
+  Clause c1 = Clause{Lit(2, true), Lit(3, true), Lit(4, false)};
+  Clause c2 = Clause{Lit(5, false), Lit(6, true)};
+  CRef cr0 = ca.alloc(c0, false);
+  CRef cr1 = ca.alloc(c1, true);
+  CRef cr2 = ca.alloc(c2, true);
+  assert(ca[cr0].size() == 2 && !ca[cr0].learnt());
+  assert(ca[cr1].size() == 3 && ca[cr1].learnt());
+  assert(Clause(ca[cr1].begin(), ca[cr1].end()) == c1);
+  ca[cr1].set_lbd(2);
+  assert(ca[cr1].lbd() == 2 && ca[cr1].learnt());
+
+  // compaction
+  ca.free(cr0);
+  assert(ca.wasted() == ArenaClause::HEADER_WORDS + c0.size());
+  ClauseArena to;
+  CRef old_cr1 = cr1;
+  ca.reloc(cr1, to);
+  ca.reloc(cr2, to);
+  assert(cr1 == 0);
+  assert(Clause(to[cr1].begin(), to[cr1].end()) == c1);
+  assert(to[cr1].lbd() == 2);
+  assert(to[cr1].learnt() && !to[cr1].reloced());
+  assert(Clause(to[cr2].begin(), to[cr2].end()) == c2);
+  // references to a moved clause follow it
+  ca.reloc(old_cr1, to);
+  assert(old_cr1 == cr1);
+  assert(to.size() == 2 * ArenaClause::HEADER_WORDS + c1.size() + c2.size());
+}
+
+void test_reduce_learnts() {
+  test_start(__func__);
+
+  Solver solver = Solver(20);
+  // core
+  solver.add_learnt_clause(Clause{Lit(0, true), Lit(1, true), Lit(2, true)},
+                           2);
+  // tier2
+  CRef tier2 = solver.add_learnt_clause(
+      Clause{Lit(3, true), Lit(4, true), Lit(5, true)}, 5);
+  // local
+  for (int v = 6; v < 14; v++) {
+    solver.add_learnt_clause(
+        Clause{Lit(v, true), Lit(v + 1, true), Lit(v + 2, true)}, 10);
+  }
+  assert(solver.num_learnts() == 10);
+  solver.clause_at(tier2).set_used(true);
+
+  // half of local clauses are removed
+  solver.reduce_learnts();
+  assert(solver.num_learnts() == 6);
+
+  // The tier2 clause isn't used since the last reduction and is evicted as
+  // a local clause. (1 + (4 + 1) / 2)
+  solver.reduce_learnts();
+  assert(solver.num_learnts() == 3);
+}
+
+void test_clause_activity() {
+  test_start(__func__);
+
+  Solver solver = Solver(6);
+  CRef core = solver.add_learnt_clause(
+      Clause{Lit(0, true), Lit(1, true), Lit(2, true)}, 2);
+  CRef local = solver.add_learnt_clause(
+      Clause{Lit(3, true), Lit(4, true), Lit(5, true)}, 10);
+  // `cr` is the conflict after its literals are decided false
+  auto conflict_with = [&](CRef cr) {
+    for (const Lit lit : solver.clause_at(cr)) {
+      solver.new_decision(~lit);
+    }
+    (void)solver.analyze(cr);
+    solver.pop_queue_until(0);
+  };
+  solver.clause_at(core).set_activity(2e20f);
+  solver.clause_at(local).set_activity(0.0f);
+  // The Core clause passes the threshold and is rescaled with the others.
+  conflict_with(core);
+  assert(solver.clause_at(core).activity() < 1e20f);
+  // Later bumps of it don't rescale again, so the increment stays usable.
+  for (int i = 0; i < 10; i++) {
+    conflict_with(core);
+  }
+  const float before = solver.clause_at(local).activity();
+  conflict_with(local);
+  assert(solver.clause_at(local).activity() > before);
+}
+
+void test_inprocess() {
+  test_start(__func__);
+  // Preprocessing expects no learnt clauses.
+  SolverOptions options;
+  options.preprocess = false;
+  Solver solver = Solver(6, options);
+  // !x0 => x1 => x2
+  solver.add_clause(Clause{Lit(0, true), Lit(1, true)});
+  solver.add_clause(Clause{Lit(1, false), Lit(2, true)});
+  // duplicate
+  solver.add_learnt_clause(Clause{Lit(1, true), Lit(0, true)}, 2);
+  // vivified to (x0 v x2)
+  solver.add_learnt_clause(Clause{Lit(0, true), Lit(3, true), Lit(2, true)},
+                           3);
+  // (x3 v x4 v x5) subsumes (x3 v x4 v x5 v x0)
+  solver.add_learnt_clause(Clause{Lit(3, true), Lit(4, true), Lit(5, true)},
+                           3);
+  solver.add_learnt_clause(
+      Clause{Lit(3, true), Lit(4, true), Lit(5, true), Lit(0, true)}, 4);
+  assert(solver.num_learnts() == 4);
+
+  assert(solver.inprocess());
+  assert(solver.decision_level() == 0);
+  assert(solver.stats.duplicate_binaries == 1);
+  assert(solver.stats.subsumed == 1);
+  assert(solver.stats.vivified == 1);
+  assert(solver.num_learnts() == 2);
+  assert(solver.solve() == Status::Sat);
+}
+
+void test_restart() {
+  test_start(__func__);
+  {
+    vector<double> seq;
+    for (uint64_t i = 0; i < 15; i++) {
+      seq.push_back(luby(2, i));
+    }
+    vector<double> expected = {1, 1, 2, 1, 1, 2, 4, 1, 1, 2, 1, 1, 2, 4, 8};
+    assert(seq == expected);
+  }
+  {
+    SolverOptions options;
+    options.restart = RestartPolicy::Luby;
+    options.restart_first = 2;
+    RestartScheduler restart(options);
+    // 2, 2, 4
+    for (int limit : {2, 2, 4}) {
+      for (int i = 0; i < limit; i++) {
+        assert(!restart.should_restart());
+        restart.on_conflict(3, 10);
+      }
+      assert(restart.should_restart());
+      restart.on_restart();
+    }
+  }
+  {
+    SolverOptions options;
+    options.restart = RestartPolicy::None;
+    RestartScheduler restart(options);
+    for (size_t i = 0; i < 1000; i++) {
+      restart.on_conflict(3, 10);
+    }
+    assert(!restart.should_restart());
+  }
+  {
+    // LBDs get worse
+    RestartScheduler restart = RestartScheduler();
+    for (size_t i = 0; i < 1000; i++) {
+      restart.on_conflict(3, 10);
+    }
+    assert(!restart.should_restart());
+    for (size_t i = 0; i < 100; i++) {
+      restart.on_conflict(30, 10);
+    }
+    assert(restart.should_restart());
+  }
+}
+
+// DefaultConfig without learnt clause reduction
+struct KeepLearnts : DefaultConfig {
+  static constexpr bool reduce = false;
+};
+
+void test_config() {
+  test_start(__func__);
+  using LubySwitch =
+      SearchConfig<RestartPolicy::Luby, BranchingHeuristic::Switch>;
+  SolverOptions options;
+  options.restart = RestartPolicy::Luby;
+  options.branching = BranchingHeuristic::Switch;
+  Solver runtime = Solver(0, options);
+  // The fixed policies override the options.
+  BasicSolver<LubySwitch> fixed = BasicSolver<LubySwitch>(0);
+  BasicSolver<KeepLearnts> keep = BasicSolver<KeepLearnts>(0, options);
+  add_pigeonhole(runtime, 7);
+  add_pigeonhole(fixed, 7);
+  add_pigeonhole(keep, 7);
+  assert(runtime.solve() == Status::Unsat);
+  assert(fixed.solve() == Status::Unsat);
+  assert(fixed.stats.conflicts == runtime.stats.conflicts);
+  assert(fixed.stats.decisions == runtime.stats.decisions);
+  assert(runtime.stats.reductions > 0);
+  assert(keep.solve() == Status::Unsat);
+  assert(keep.stats.reductions == 0);
+}
+
+void test_chrono() {
+  test_start(__func__);
+  SolverOptions options;
+  options.chrono = true;
+  // Backtrack chronologically on every conflict.
+  options.chrono_levels = 0;
+  options.keep_input_clauses = true;
+  {
+    Solver solver = Solver(0, options);
+    add_pigeonhole(solver, 7);
+    assert(solver.solve() == Status::Unsat);
+    assert(solver.stats.chrono_backtracks > 0);
+  }
+  // random 3-SAT below the threshold
+  std::mt19937 rng(3);
+  for (size_t round = 0; round < 20; round++) {
+    Solver solver = Solver(150, options);
+    add_random_3sat(solver, rng, 150, 600);
+    if (solver.solve() == Status::Sat) {
+      assert(solver.check_model());
+    }
+  }
+}
+
+void test_walk() {
+  test_start(__func__);
+  // random 3-SAT below the threshold
+  std::mt19937 rng(5);
+  const vector<Clause> clauses = random_3sat(rng, 150, 500);
+  {
+    LocalSearch walker(1);
+    walker.reset(150);
+    for (const Clause &clause : clauses) {
+      walker.add_clause(clause.begin(), clause.end());
+    }
+    assert(walker.run(vector<bool>(150, false), 1000000));
+    for (const Clause &clause : clauses) {
+      assert(std::any_of(clause.begin(), clause.end(), [&](Lit lit) {
+        return walker.best()[lit.vidx()] == lit.pos();
+      }));
+    }
+    // (x0) and (!x0) can't be satisfied together.
+    walker.reset(1);
+    const Lit x0 = Lit(0, true);
+    const Lit nx0 = ~x0;
+    walker.add_clause(&x0, &x0 + 1);
+    walker.add_clause(&nx0, &nx0 + 1);
+    assert(!walker.run(vector<bool>(1, false), 100));
+    assert(walker.flips == 100);
+  }
+  {
+    // The model comes from local search before any conflict.
+    SolverOptions options;
+    options.keep_input_clauses = true;
+    Solver solver = Solver(150, options);
+    for (const Clause &clause : clauses) {
+      solver.add_clause(clause);
+    }
+    assert(solver.solve() == Status::Sat);
+    assert(solver.stats.walks == 1 && solver.stats.conflicts == 0);
+    assert(solver.check_model());
+  }
+}
+
+void test_memory() {
+  test_start(__func__);
+  {
+    Solver solver = Solver(0);
+    add_pigeonhole(solver, 6);
+    const size_t loaded = solver.memory_usage();
+    assert(loaded > 0);
+    assert(solver.solve() == Status::Unsat);
+    assert(solver.stats.memory_bytes == solver.memory_usage());
+    assert(solver.stats.memory_bytes > loaded);
+    assert(solver.stats.memory_reductions == 0);
+  }
+  {
+    // The input alone doesn't fit.
+    Solver solver = Solver(0);
+    add_pigeonhole(solver, 6);
+    Budget budget;
+    budget.memory_bytes = solver.memory_usage() / 2;
+    solver.set_budget(budget);
+    assert(solver.solve() == Status::Unknown);
+    assert(solver.stats.decisions == 0);
+    assert(solver.stats.memory_reductions == 1);
+  }
+  {
+    // Learnt clauses are never reduced but for the memory limit.
+    BasicSolver<KeepLearnts> solver(0);
+    add_pigeonhole(solver, 8);
+    const size_t loaded = solver.memory_usage();
+    Budget budget;
+    budget.memory_bytes = loaded * 5;
+    solver.set_budget(budget);
+    const Status status = solver.solve();
+    assert(status == Status::Unsat || status == Status::Unknown);
+    assert(solver.stats.memory_reductions > 0);
+  }
+}
+
+void test_reset() {
+  test_start(__func__);
+  SolverOptions options;
+  options.keep_input_clauses = true;
+  // random 3-SAT around the threshold
+  std::mt19937 rng(6);
+  Solver reused = Solver(0, options);
+  for (size_t round = 0; round < 10; round++) {
+    const auto state = rng;
+    Solver fresh = Solver(0, options);
+    if (round % 2 == 0) {
+      add_random_3sat(fresh, rng, 100, 420);
+    } else {
+      add_pigeonhole(fresh, 5);
+    }
+    rng = state;
+    // A solver reset after another formula searches the same way.
+    reused.reset(0, options);
+    if (round % 2 == 0) {
+      add_random_3sat(reused, rng, 100, 420);
+    } else {
+      add_pigeonhole(reused, 5);
+    }
+    const Status status = fresh.solve();
+    assert(reused.solve() == status);
+    assert(reused.stats.conflicts == fresh.stats.conflicts);
+    assert(reused.stats.decisions == fresh.stats.decisions);
+    assert(reused.stats.propagations == fresh.stats.propagations);
+    if (status == Status::Sat) {
+      assert(reused.check_model());
+    }
+  }
+  reused.reset(3, options);
+  assert(reused.num_vars() == 3 && reused.num_assigned() == 0);
+  reused.add_clause({Lit(2, false)});
+  assert(reused.solve() == Status::Sat && !reused.assings[2]);
+}
+
+void test_snapshot() {
+  test_start(__func__);
+  std::mt19937 rng(7);
+  for (size_t round = 0; round < 8; round++) {
+    CnfData cnf;
+    cnf.clauses = random_3sat(rng, 100, 400);
+    // a unit and a duplicate clause
+    cnf.clauses.push_back({Lit(Var(round), true)});
+    cnf.clauses.push_back(cnf.clauses.front());
+    SolverOptions options;
+    options.preprocess = round % 2 == 0;
+    Solver solver = Solver(0, options);
+    for (const Clause &clause : cnf.clauses) {
+      solver.add_clause(clause);
+    }
+    std::ostringstream os;
+    solver.write_snapshot(os);
+    const std::string bytes = os.str();
+    assert(is_snapshot(bytes.data(), bytes.size()));
+
+    Solver loaded = Solver(0, options);
+    auto in = InputStream::from_memory(bytes.data(), bytes.size());
+    assert(!load_input(*in, loaded).has_value());
+    assert(loaded.num_vars() == solver.num_vars());
+    const Status status = solver.solve();
+    assert(loaded.solve() == status);
+    if (status == Status::Sat) {
+      assert(check_model(cnf, loaded.assings));
+    }
+    // through a buffer
+    std::istringstream stream(bytes);
+    InputStream buffered(std::make_unique<IstreamSource>(stream));
+    Solver again = Solver(0, options);
+    assert(!load_input(buffered, again).has_value());
+    assert(again.solve() == status);
+
+    Solver broken = Solver(0, options);
+    assert(broken.load_snapshot(bytes.data(), bytes.size() - 4).has_value());
+    // Overwrite words of the sections after the header.
+    SnapshotHeader header;
+    std::memcpy(&header, bytes.data() + sizeof(SNAPSHOT_MAGIC),
+                sizeof(header));
+    const char *sections = bytes.data() + sizeof(SNAPSHOT_MAGIC) +
+                           sizeof(header);
+    auto word = [&](size_t i) {
+      uint32_t w;
+      std::memcpy(&w, sections + i * sizeof(uint32_t), sizeof(w));
+      return w;
+    };
+    auto corrupt = [&](std::vector<std::pair<size_t, uint32_t>> words) {
+      std::string copy = bytes;
+      for (const auto &[i, w] : words) {
+        std::memcpy(copy.data() + (sections - bytes.data()) +
+                        i * sizeof(uint32_t),
+                    &w, sizeof(w));
+      }
+      Solver corrupted = Solver(0, options);
+      return corrupted.load_snapshot(copy.data(), copy.size()).has_value();
+    };
+    const size_t offsets = header.units;
+    assert(header.clauses >= 2);
+    // the same clause twice
+    assert(corrupt({{offsets + 1, word(offsets)}}));
+    // a clause from the middle of another
+    assert(corrupt({{offsets, word(offsets) + 1}}));
+    const size_t elim_sizes =
+        offsets + header.clauses + header.arena_words + header.elim_vars;
+    const size_t elim_lits = elim_sizes + header.elim_clauses;
+    if (options.preprocess) {
+      assert(header.elim_clauses >= 2);
+      // an empty clause with the same total of literals
+      assert(corrupt({{elim_sizes, 0},
+                      {elim_sizes + 1, word(elim_sizes) +
+                                           word(elim_sizes + 1)}}));
+      // a clause that starts with a variable not eliminated
+      const uint32_t unit = word(0);
+      assert(corrupt({{elim_lits, unit}}));
+    }
+  }
 }
 
 int main() {
   cerr << "===================== test ===================== " << endl;
   test_heap();
+  test_clause_arena();
+  test_branching();
+  test_phases();
   test_lit();
+  test_find_value();
   test_enqueue_and_eval();
   test_propagate();
+  test_propagate_binary();
   test_queue();
   test_analyze();
+  test_minimize();
+  test_reduce_learnts();
+  test_clause_activity();
+  test_inprocess();
+  test_restart();
   test_solve();
+  test_preprocess();
   test_parse_cnf();
+  test_parse_dimacs();
+  test_parse_compressed();
+  test_clause_exchange();
+  test_portfolio();
+  test_cube_and_conquer();
+  test_incremental();
+  test_budget();
+  test_output_buffer();
+  test_proof();
+  test_config();
+  test_chrono();
+  test_walk();
+  test_memory();
+  test_reset();
+  test_snapshot();
 }